@@ -0,0 +1,80 @@
+/*
+ * cache_file.c
+ *
+ * Un file condiviso in /tmp con permessi 0666 permette a qualunque utente di
+ * scriverci voci false o di troncarlo mentre un altro processo lo ha mappato
+ * (SIGBUS al primo accesso). Qui il file è privato dell'utente: solo i suoi
+ * processi client lo condividono.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cache_file.h"
+
+#if defined WIN32
+
+int cache_file_path(const char *name, char *path, size_t path_len)
+{ (void)name; (void)path; (void)path_len; return 0; }
+int cache_file_open(const char *name, size_t size) { (void)name; (void)size; return -1; }
+
+#else
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#ifndef O_NOFOLLOW
+#define O_NOFOLLOW 0
+#endif
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+int cache_file_path(const char *name, char *path, size_t path_len) {
+    const char *dir = getenv("XDG_RUNTIME_DIR");
+    int len;
+
+    /* la directory di runtime è già privata dell'utente */
+    if (dir != NULL && dir[0] == '/')
+        len = snprintf(path, path_len, "%s/%s", dir, name);
+    else
+        len = snprintf(path, path_len, "/tmp/%s.%lu", name, (unsigned long)getuid());
+    return len > 0 && (size_t)len < path_len;
+}
+
+int cache_file_open(const char *name, size_t size) {
+    char path[512];
+    if (!cache_file_path(name, path, sizeof(path)))
+        return -1;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return -1;
+
+    flock(fd, LOCK_EX);
+
+    /*
+     * Un file preparato da un altro utente (anche con lo stesso nome, in /tmp)
+     * viene rifiutato: si lavora senza cache invece di fidarsi del contenuto.
+     */
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_uid != getuid() ||
+        (st.st_mode & 077) != 0 || st.st_nlink != 1) {
+        fprintf(stderr, "Cache %s ignorata: il file non appartiene all'utente o non è privato.\n", path);
+        flock(fd, LOCK_UN);
+        close(fd);
+        return -1;
+    }
+
+    /* il file è dell'utente: una dimensione diversa viene da un formato precedente */
+    if ((size_t)st.st_size != size && ftruncate(fd, (off_t)size) < 0) {
+        flock(fd, LOCK_UN);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+#endif
@@ -0,0 +1,26 @@
+/*
+ * cache_file.h
+ *
+ * Apertura sicura dei file di cache mappati in memoria: un file per utente
+ * ($XDG_RUNTIME_DIR/<nome>, altrimenti /tmp/<nome>.<uid>), creato con
+ * permessi 0600, senza seguire link simbolici e rifiutato se appartiene a
+ * un altro utente o è accessibile ad altri.
+ */
+
+#ifndef CACHE_FILE_H_
+#define CACHE_FILE_H_
+
+#include <stddef.h>
+
+/* Percorso del file di cache name per l'utente corrente; 0 se non rappresentabile */
+int cache_file_path(const char *name, char *path, size_t path_len);
+
+/*
+ * Apre (o crea) il file di cache name e lo porta a size byte.
+ * Restituisce il descrittore con un lock esclusivo (flock) già preso,
+ * che il chiamante rilascia dopo l'inizializzazione; -1 se non disponibile
+ * o non sicuro.
+ */
+int cache_file_open(const char *name, size_t size);
+
+#endif /* CACHE_FILE_H_ */
@@ -0,0 +1,213 @@
+/*
+ * dns_cache.c
+ *
+ * Cache DNS condivisa su file.
+ *
+ * Il file contiene una tabella fissa di voci indicizzate dal nome del server
+ * (come passato con -s, in minuscolo). Ogni voce ha una scadenza separata
+ * per la risoluzione diretta e per quella inversa. Le letture prendono un
+ * lock condiviso (flock), le scritture un lock esclusivo. Il file è privato
+ * dell'utente (vedi cache_file.h).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "dns_cache.h"
+#include "cache_file.h"
+
+#if defined WIN32
+
+int dns_cache_open(void) { return 0; }
+int dns_cache_get_addrs(const char *host, dns_addr_t out[DNS_ADDR_MAX]) { (void)host; (void)out; return 0; }
+void dns_cache_put_addrs(const char *host, const dns_addr_t addrs[], int n) { (void)host; (void)addrs; (void)n; }
+void dns_cache_prefer_addr(const char *host, const dns_addr_t *addr) { (void)host; (void)addr; }
+int dns_cache_get_name(const char *host, char *name, size_t name_len)
+{ (void)host; (void)name; (void)name_len; return 0; }
+void dns_cache_put_name(const char *host, const char *name) { (void)host; (void)name; }
+void dns_cache_close(void) { }
+
+#else
+
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+typedef struct {
+    char host[DNS_HOST_MAX];            // chiave; "" = voce libera
+    int64_t addr_expires;               // 0 = risoluzione diretta assente
+    int64_t name_expires;               // 0 = risoluzione inversa assente
+    int32_t n_addrs;
+    dns_addr_t addrs[DNS_ADDR_MAX];     // nell'ordine in cui provarli
+    char name[DNS_NAME_MAX];
+} dns_cache_entry_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t entry_size;                // cambia se cambia il formato
+    dns_cache_entry_t entries[DNS_CACHE_ENTRIES];
+} dns_cache_file_t;
+
+static int cache_fd = -1;
+static dns_cache_file_t *cache = NULL;
+
+int dns_cache_open(void) {
+    if (cache != NULL) return 1;
+
+    /* lock esclusivo già preso: l'inizializzazione la esegue un solo processo */
+    cache_fd = cache_file_open(DNS_CACHE_NAME, sizeof(dns_cache_file_t));
+    if (cache_fd < 0)
+        return 0;
+
+    void *mem = mmap(NULL, sizeof(dns_cache_file_t), PROT_READ | PROT_WRITE, MAP_SHARED, cache_fd, 0);
+    if (mem == MAP_FAILED) {
+        flock(cache_fd, LOCK_UN);
+        close(cache_fd);
+        cache_fd = -1;
+        return 0;
+    }
+    cache = (dns_cache_file_t*)mem;
+
+    if (cache->magic != DNS_CACHE_MAGIC || cache->entry_size != sizeof(dns_cache_entry_t)) {
+        memset(cache, 0, sizeof(*cache));
+        cache->magic = DNS_CACHE_MAGIC;
+        cache->entry_size = sizeof(dns_cache_entry_t);
+    }
+
+    flock(cache_fd, LOCK_UN);
+    return 1;
+}
+
+void dns_cache_close(void) {
+    if (cache == NULL) return;
+    munmap(cache, sizeof(dns_cache_file_t));
+    close(cache_fd);
+    cache = NULL;
+    cache_fd = -1;
+}
+
+/* Chiave normalizzata: nome in minuscolo; 0 se troppo lungo per la cache */
+static int make_key(const char *host, char key[DNS_HOST_MAX]) {
+    size_t len = strlen(host);
+    if (len == 0 || len >= DNS_HOST_MAX) return 0;
+
+    memset(key, 0, DNS_HOST_MAX);
+    for (size_t i = 0; i < len; i++)
+        key[i] = (char)tolower((unsigned char)host[i]);
+    return 1;
+}
+
+static dns_cache_entry_t *find(const char key[DNS_HOST_MAX]) {
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+        if (strncmp(cache->entries[i].host, key, DNS_HOST_MAX) == 0)
+            return &cache->entries[i];
+    }
+    return NULL;
+}
+
+/* Voce per key, creandola se serve: libera, altrimenti quella che scade prima */
+static dns_cache_entry_t *find_or_evict(const char key[DNS_HOST_MAX], int64_t now) {
+    dns_cache_entry_t *e = find(key);
+    if (e != NULL) return e;
+
+    dns_cache_entry_t *victim = &cache->entries[0];
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+        dns_cache_entry_t *c = &cache->entries[i];
+        int64_t c_exp = c->addr_expires > c->name_expires ? c->addr_expires : c->name_expires;
+        int64_t v_exp = victim->addr_expires > victim->name_expires ? victim->addr_expires : victim->name_expires;
+        if (c->host[0] == '\0' || c_exp <= now) {
+            victim = c;
+            break;
+        }
+        if (c_exp < v_exp)
+            victim = c;
+    }
+
+    memset(victim, 0, sizeof(*victim));
+    memcpy(victim->host, key, DNS_HOST_MAX);
+    return victim;
+}
+
+int dns_cache_get_addrs(const char *host, dns_addr_t out[DNS_ADDR_MAX]) {
+    char key[DNS_HOST_MAX];
+    if (cache == NULL || !make_key(host, key)) return 0;
+
+    int n = 0;
+    flock(cache_fd, LOCK_SH);
+    dns_cache_entry_t *e = find(key);
+    if (e != NULL && e->addr_expires > (int64_t)time(NULL) && e->n_addrs > 0 && e->n_addrs <= DNS_ADDR_MAX) {
+        n = e->n_addrs;
+        memcpy(out, e->addrs, (size_t)n * sizeof(dns_addr_t));
+    }
+    flock(cache_fd, LOCK_UN);
+    return n;
+}
+
+void dns_cache_put_addrs(const char *host, const dns_addr_t addrs[], int n) {
+    char key[DNS_HOST_MAX];
+    if (cache == NULL || n <= 0 || !make_key(host, key)) return;
+    if (n > DNS_ADDR_MAX) n = DNS_ADDR_MAX;
+
+    int64_t now = (int64_t)time(NULL);
+    flock(cache_fd, LOCK_EX);
+    dns_cache_entry_t *e = find_or_evict(key, now);
+    /* indirizzi diversi invalidano il nome inverso associato */
+    if (e->n_addrs != n || memcmp(e->addrs, addrs, (size_t)n * sizeof(dns_addr_t)) != 0)
+        e->name_expires = 0;
+    memset(e->addrs, 0, sizeof(e->addrs));
+    memcpy(e->addrs, addrs, (size_t)n * sizeof(dns_addr_t));
+    e->n_addrs = n;
+    e->addr_expires = now + DNS_CACHE_TTL;
+    flock(cache_fd, LOCK_UN);
+}
+
+void dns_cache_prefer_addr(const char *host, const dns_addr_t *addr) {
+    char key[DNS_HOST_MAX];
+    if (cache == NULL || !make_key(host, key)) return;
+
+    flock(cache_fd, LOCK_EX);
+    dns_cache_entry_t *e = find(key);
+    for (int i = 1; e != NULL && i < e->n_addrs && i < DNS_ADDR_MAX; i++) {
+        if (memcmp(&e->addrs[i], addr, sizeof(*addr)) != 0) continue;
+
+        /* in testa; il nome inverso era di un altro indirizzo */
+        memmove(&e->addrs[1], &e->addrs[0], (size_t)i * sizeof(dns_addr_t));
+        e->addrs[0] = *addr;
+        e->name_expires = 0;
+        break;
+    }
+    flock(cache_fd, LOCK_UN);
+}
+
+int dns_cache_get_name(const char *host, char *name, size_t name_len) {
+    char key[DNS_HOST_MAX];
+    if (cache == NULL || !make_key(host, key)) return 0;
+
+    int found = 0;
+    flock(cache_fd, LOCK_SH);
+    dns_cache_entry_t *e = find(key);
+    if (e != NULL && e->name_expires > (int64_t)time(NULL)) {
+        snprintf(name, name_len, "%s", e->name);
+        found = 1;
+    }
+    flock(cache_fd, LOCK_UN);
+    return found;
+}
+
+void dns_cache_put_name(const char *host, const char *name) {
+    char key[DNS_HOST_MAX];
+    if (cache == NULL || !make_key(host, key)) return;
+
+    int64_t now = (int64_t)time(NULL);
+    flock(cache_fd, LOCK_EX);
+    dns_cache_entry_t *e = find_or_evict(key, now);
+    snprintf(e->name, sizeof(e->name), "%s", name);
+    e->name_expires = now + DNS_CACHE_TTL;
+    flock(cache_fd, LOCK_UN);
+}
+
+#endif /* WIN32 */
@@ -0,0 +1,47 @@
+/*
+ * dns_cache.h
+ *
+ * Cache su disco dei risultati di risoluzione del server (diretta e inversa),
+ * condivisa tra le esecuzioni del client dello stesso utente tramite un file
+ * mappato in memoria e protetto da lock.
+ */
+
+#ifndef DNS_CACHE_H_
+#define DNS_CACHE_H_
+
+#include <stddef.h>
+
+#define DNS_CACHE_NAME    "weather_dns_cache" // file per utente, vedi cache_file.h
+#define DNS_CACHE_MAGIC   0x57444E43u     // "WDNC"
+#define DNS_CACHE_ENTRIES 64
+#define DNS_CACHE_TTL     300             // secondi (getaddrinfo non espone il TTL reale)
+#define DNS_HOST_MAX      64
+#define DNS_NAME_MAX      256
+#define DNS_ADDR_MAX      4               // indirizzi conservati per nome
+
+/* Indirizzo risolto: famiglia (AF_INET/AF_INET6) e byte dell'indirizzo */
+typedef struct {
+    int family;
+    unsigned char addr[16];
+} dns_addr_t;
+
+/* Apre (o crea) il file della cache; 0 se non disponibile */
+int dns_cache_open(void);
+
+/*
+ * Indirizzi validi per host, nell'ordine in cui provarli: quanti ne ha
+ * scritti in out (0 se assenti o scaduti)
+ */
+int dns_cache_get_addrs(const char *host, dns_addr_t out[DNS_ADDR_MAX]);
+void dns_cache_put_addrs(const char *host, const dns_addr_t addrs[], int n);
+
+/* addr ha risposto: le esecuzioni successive lo provano per primo */
+void dns_cache_prefer_addr(const char *host, const dns_addr_t *addr);
+
+/* Nome canonico (risoluzione inversa) valido per host */
+int dns_cache_get_name(const char *host, char *name, size_t name_len);
+void dns_cache_put_name(const char *host, const char *name);
+
+void dns_cache_close(void);
+
+#endif /* DNS_CACHE_H_ */
@@ -0,0 +1,306 @@
+/*
+ * fastpath.c
+ *
+ * Trasporti locali del client.
+ *
+ * Se il server è sullo stesso host si evita lo stack UDP/IP:
+ * prima si prova il ring in memoria condivisa (slot + futex),
+ * poi il socket AF_UNIX SOCK_DGRAM. Il formato dei buffer è lo stesso di UDP.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "fastpath.h"
+
+#if defined WIN32
+
+int fastpath_open(int port) { (void)port; return FASTPATH_NONE; }
+int fastpath_query(const uint8_t req[REQ_BUFFER_SIZE], uint8_t resp[RESP_BUFFER_SIZE])
+{ (void)req; (void)resp; return 0; }
+const char *fastpath_name(void) { return "udp"; }
+void fastpath_close(void) { }
+
+#else
+
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+
+static int mode = FASTPATH_NONE;
+static int unix_sock = -1;
+static char unix_local_path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+static struct sockaddr_un unix_server;
+
+/*
+ * Socket e ring hanno nomi fissi, che chiunque può creare prima del server
+ * per rispondere al suo posto. Si usano solo se appartengono all'utente del
+ * client o a root e se nessun altro può scriverci.
+ */
+static int trusted_owner(const struct stat *st) {
+    return (st->st_uid == getuid() || st->st_uid == 0) && (st->st_mode & 022) == 0;
+}
+
+/* ---- SOCKET AF_UNIX ---- */
+
+static void unix_close(void);
+
+static int unix_open(int port) {
+    memset(&unix_server, 0, sizeof(unix_server));
+    unix_server.sun_family = AF_UNIX;
+    snprintf(unix_server.sun_path, sizeof(unix_server.sun_path), UNIX_SOCKET_FMT, port);
+
+    struct stat before, after;
+    if (lstat(unix_server.sun_path, &before) < 0 || !S_ISSOCK(before.st_mode) || !trusted_owner(&before))
+        return 0;
+
+    unix_sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (unix_sock < 0)
+        return 0;
+
+    /* il client deve avere un indirizzo per ricevere la risposta */
+    struct sockaddr_un local;
+    memset(&local, 0, sizeof(local));
+    local.sun_family = AF_UNIX;
+#if defined __linux__
+    /* autobind: indirizzo astratto assegnato dal kernel, nessun file da rimuovere */
+    if (bind(unix_sock, (struct sockaddr*)&local, sizeof(sa_family_t)) < 0) {
+#else
+    snprintf(local.sun_path, sizeof(local.sun_path), "/tmp/weather_client_%d.sock", (int)getpid());
+    unlink(local.sun_path);
+    if (bind(unix_sock, (struct sockaddr*)&local, sizeof(local)) < 0) {
+#endif
+        close(unix_sock);
+        unix_sock = -1;
+        return 0;
+    }
+    snprintf(unix_local_path, sizeof(unix_local_path), "%s", local.sun_path);
+
+    /*
+     * connessa al file appena verificato: se nel frattempo è stato sostituito
+     * l'inode non coincide. Da qui arrivano solo datagrammi di quel socket.
+     */
+    if (connect(unix_sock, (struct sockaddr*)&unix_server, sizeof(unix_server)) < 0 ||
+        lstat(unix_server.sun_path, &after) < 0 ||
+        after.st_dev != before.st_dev || after.st_ino != before.st_ino) {
+        unix_close();
+        return 0;
+    }
+
+    /* un server AF_UNIX morto non deve bloccare il client */
+    struct timeval tv = { SHM_TIMEOUT_MS / 1000, (SHM_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(unix_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    return 1;
+}
+
+static int unix_query(const uint8_t req[REQ_BUFFER_SIZE], uint8_t resp[RESP_BUFFER_SIZE]) {
+    if (send(unix_sock, req, REQ_BUFFER_SIZE, 0) != REQ_BUFFER_SIZE)
+        return 0;
+
+    return recv(unix_sock, resp, RESP_BUFFER_SIZE, 0) == RESP_BUFFER_SIZE;
+}
+
+static void unix_close(void) {
+    if (unix_sock < 0) return;
+    close(unix_sock);
+    unix_sock = -1;
+    if (unix_local_path[0] != '\0')
+        unlink(unix_local_path);
+}
+
+/* ---- RING IN MEMORIA CONDIVISA ---- */
+
+#if defined __linux__
+
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define SPIN_ITERATIONS 2000   // attesa attiva prima di dormire sul futex
+
+static shm_ring_t *ring = NULL;
+
+static int shm_open_ring(int port) {
+    char name[64];
+    snprintf(name, sizeof(name), SHM_RING_FMT, port);
+
+    int fd = shm_open(name, O_RDWR | O_NOFOLLOW, 0);
+    if (fd < 0)
+        return 0;
+
+    /* un segmento più corto del ring darebbe SIGBUS al primo accesso */
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !trusted_owner(&st) || (size_t)st.st_size < sizeof(shm_ring_t)) {
+        close(fd);
+        return 0;
+    }
+
+    void *mem = mmap(NULL, sizeof(shm_ring_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED)
+        return 0;
+
+    ring = (shm_ring_t*)mem;
+
+    /*
+     * ring non inizializzato o lasciato da un server terminato. EPERM vuol
+     * dire "vivo" solo per un server di root: un processo dello stesso
+     * utente si può sempre segnalare.
+     */
+    if (__atomic_load_n(&ring->magic, __ATOMIC_ACQUIRE) != SHM_RING_MAGIC ||
+        (kill((pid_t)ring->server_pid, 0) < 0 && (errno != EPERM || st.st_uid != 0))) {
+        munmap(mem, sizeof(shm_ring_t));
+        ring = NULL;
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Prende uno slot libero; l'indice di partenza sparge i client sul ring */
+static shm_slot_t *claim_slot(void) {
+    unsigned start = (unsigned)getpid();
+
+    for (unsigned i = 0; i < SHM_RING_SLOTS; i++) {
+        shm_slot_t *slot = &ring->slots[(start + i) % SHM_RING_SLOTS];
+        uint32_t expected = SLOT_FREE;
+        if (__atomic_compare_exchange_n(&slot->state, &expected, SLOT_CLAIMED, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            /* proprietario: se il client muore il server recupera lo slot */
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            __atomic_store_n(&slot->claimed_ms, (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000), __ATOMIC_RELAXED);
+            __atomic_store_n(&slot->owner_pid, (uint32_t)getpid(), __ATOMIC_RELEASE);
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+/* Restituisce lo slot; owner_pid torna a 0 prima che altri possano prenderlo */
+static void release_slot(shm_slot_t *slot) {
+    __atomic_store_n(&slot->owner_pid, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->state, SLOT_FREE, __ATOMIC_RELEASE);
+}
+
+static int shm_query(const uint8_t req[REQ_BUFFER_SIZE], uint8_t resp[RESP_BUFFER_SIZE]) {
+    shm_slot_t *slot = claim_slot();
+    if (slot == NULL)
+        return 0;   // ring pieno
+
+    memcpy(slot->req, req, REQ_BUFFER_SIZE);
+    __atomic_store_n(&slot->state, SLOT_REQUEST, __ATOMIC_RELEASE);
+
+    /* suona il doorbell; syscall solo se il server sta dormendo */
+    __atomic_add_fetch(&ring->doorbell, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->server_waiting, __ATOMIC_SEQ_CST))
+        syscall(SYS_futex, &ring->doorbell, FUTEX_WAKE, 1, NULL, NULL, 0);
+
+    struct timespec deadline, now;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += SHM_TIMEOUT_MS / 1000;
+    deadline.tv_nsec += (SHM_TIMEOUT_MS % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    int spins = 0;
+    uint32_t state;
+    while ((state = __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE)) != SLOT_RESPONSE) {
+        if (spins < SPIN_ITERATIONS) {
+            spins++;
+            continue;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        struct timespec left = { deadline.tv_sec - now.tv_sec, deadline.tv_nsec - now.tv_nsec };
+        if (left.tv_nsec < 0) {
+            left.tv_sec--;
+            left.tv_nsec += 1000000000L;
+        }
+
+        if (left.tv_sec < 0) {
+            /* timeout: rinuncia solo se il server non ha ancora preso la richiesta */
+            uint32_t expected = SLOT_REQUEST;
+            __atomic_store_n(&slot->owner_pid, 0, __ATOMIC_RELAXED);
+            if (__atomic_compare_exchange_n(&slot->state, &expected, SLOT_FREE, 0,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+                return 0;
+            __atomic_store_n(&slot->owner_pid, (uint32_t)getpid(), __ATOMIC_RELAXED);
+            /* server terminato durante l'elaborazione: lo slot resta perso */
+            if (kill((pid_t)ring->server_pid, 0) < 0 && errno != EPERM)
+                return 0;
+            left.tv_sec = 0;
+            left.tv_nsec = 1000000L;
+        }
+
+        syscall(SYS_futex, &slot->state, FUTEX_WAIT, state, &left, NULL, 0);
+    }
+
+    memcpy(resp, slot->resp, RESP_BUFFER_SIZE);
+    release_slot(slot);
+    return 1;
+}
+
+static void shm_close(void) {
+    if (ring == NULL) return;
+    munmap(ring, sizeof(shm_ring_t));
+    ring = NULL;
+}
+
+#else
+
+static int shm_open_ring(int port) { (void)port; return 0; }
+static int shm_query(const uint8_t req[REQ_BUFFER_SIZE], uint8_t resp[RESP_BUFFER_SIZE])
+{ (void)req; (void)resp; return 0; }
+static void shm_close(void) { }
+
+#endif /* __linux__ */
+
+int fastpath_open(int port) {
+    if (shm_open_ring(port))
+        mode = FASTPATH_SHM;
+    else if (unix_open(port))
+        mode = FASTPATH_UNIX;
+    else
+        mode = FASTPATH_NONE;
+    return mode;
+}
+
+int fastpath_query(const uint8_t req[REQ_BUFFER_SIZE], uint8_t resp[RESP_BUFFER_SIZE]) {
+    switch (mode) {
+        case FASTPATH_SHM:
+            return shm_query(req, resp);
+        case FASTPATH_UNIX:
+            return unix_query(req, resp);
+        default:
+            return 0;
+    }
+}
+
+const char *fastpath_name(void) {
+    switch (mode) {
+        case FASTPATH_SHM:
+            return "shm";
+        case FASTPATH_UNIX:
+            return "unix";
+        default:
+            return "udp";
+    }
+}
+
+void fastpath_close(void) {
+    shm_close();
+    unix_close();
+    mode = FASTPATH_NONE;
+}
+
+#endif /* WIN32 */
@@ -0,0 +1,29 @@
+/*
+ * fastpath.h
+ *
+ * Trasporti alternativi a UDP quando il server gira sullo stesso host:
+ * ring in memoria condivisa (se il server lo ha attivato) o socket AF_UNIX.
+ */
+
+#ifndef FASTPATH_H_
+#define FASTPATH_H_
+
+#include <stdint.h>
+#include "protocol.h"
+
+#define FASTPATH_NONE 0
+#define FASTPATH_UNIX 1
+#define FASTPATH_SHM  2
+
+/* Sceglie il trasporto locale migliore disponibile per la porta data */
+int fastpath_open(int port);
+
+/* Invia la richiesta serializzata e attende la risposta: 1 ok, 0 errore */
+int fastpath_query(const uint8_t req[REQ_BUFFER_SIZE], uint8_t resp[RESP_BUFFER_SIZE]);
+
+/* Nome del trasporto in uso (per l'output) */
+const char *fastpath_name(void);
+
+void fastpath_close(void);
+
+#endif /* FASTPATH_H_ */
@@ -8,12 +8,14 @@
  */
 
 #if defined WIN32
-#include <winsock.h>
+#include <winsock2.h>
+#include <ws2tcpip.h>
 #else
 #include <string.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <netdb.h>
@@ -26,8 +28,12 @@
 #include <time.h>
 #include <string.h>
 #include "protocol.h"
+#include "fastpath.h"
+#include "dns_cache.h"
+#include "resp_cache.h"
 
 #define NO_ERROR 0
+#define UDP_TIMEOUT_MS 1000   // attesa della risposta per ciascun indirizzo del server
 
 void clearwinsock() {
 #if defined WIN32
@@ -40,7 +46,7 @@ void errorhandler(const char *errorMessage){
 }
 
 void print_usage(const char *progname) {
-    printf("Uso corretto: %s [-s server] [-p port] -r \"type city\"\n", progname);
+    printf("Uso corretto: %s [-s server] [-p port] [-u] [-n ripetizioni] [-c ttl_ms [-x]] -r \"type city\"\n", progname);
 }
 
 /* Trasforma una stringa in Parola */
@@ -91,66 +97,97 @@ void deserialize_response(const uint8_t buffer[RESP_BUFFER_SIZE], weather_respon
     offset += sizeof(net_bits);
 }
 
-/* RISOLUZIONE DNS: gethostbyname / gethostbyaddr */
-int resolve_dns(const char *host_name, struct in_addr *out_addr, char *resolved_name, size_t name_len, char *resolved_ip,   size_t ip_len)
+/*
+ * RISOLUZIONE DIRETTA: cache condivisa, altrimenti getaddrinfo (IPv4 e IPv6).
+ * Restituisce tutti gli indirizzi (al più DNS_ADDR_MAX) nell'ordine in cui
+ * provarli; 0 se il nome non si risolve.
+ */
+int resolve_server(const char *host_name, dns_addr_t addrs[DNS_ADDR_MAX])
 {
-    struct hostent *host;
-    struct in_addr addr;
-
-    /* CASO 1: host_name è un NOME */
-    if (isalpha((unsigned char)host_name[0])) {
-
-        host = gethostbyname(host_name);
-        if (host == NULL) {
-            fprintf(stderr, "gethostbyname() failed for %s\n", host_name);
-            return 0;
-        }
+    int n = dns_cache_get_addrs(host_name, addrs);
+    if (n > 0)
+        return n;
+
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_protocol = IPPROTO_UDP;
+
+    int err = getaddrinfo(host_name, NULL, &hints, &res);
+    if (err != 0 || res == NULL) {
+        fprintf(stderr, "getaddrinfo() failed for %s: %s\n", host_name, gai_strerror(err));
+        return 0;
+    }
 
-        addr = *(struct in_addr *)host->h_addr_list[0];
-        *out_addr = addr;
+    for (struct addrinfo *ai = res; ai != NULL && n < DNS_ADDR_MAX; ai = ai->ai_next) {
+        if (ai->ai_family != AF_INET && ai->ai_family != AF_INET6) continue;
 
-        /* IP come stringa */
-        strncpy(resolved_ip, inet_ntoa(addr), ip_len - 1);
-        resolved_ip[ip_len - 1] = '\0';
+        memset(&addrs[n], 0, sizeof(addrs[n]));
+        addrs[n].family = ai->ai_family;
+        if (ai->ai_family == AF_INET6)
+            memcpy(addrs[n].addr, &((struct sockaddr_in6*)ai->ai_addr)->sin6_addr, 16);
+        else
+            memcpy(addrs[n].addr, &((struct sockaddr_in*)ai->ai_addr)->sin_addr, 4);
+        n++;
+    }
+    freeaddrinfo(res);
 
-        host = gethostbyaddr((char *)&addr, sizeof(addr), AF_INET);
-        if (host != NULL) {
-            strncpy(resolved_name, host->h_name, name_len - 1);
-        } else {
-            strncpy(resolved_name, host_name, name_len - 1);
-        }
-        resolved_name[name_len - 1] = '\0';
+    dns_cache_put_addrs(host_name, addrs, n);
+    return n;
+}
 
-        return 1;
+/* Indirizzo risolto e porta come sockaddr */
+void make_sockaddr(const dns_addr_t *a, int port, struct sockaddr_storage *out, socklen_t *out_len)
+{
+    memset(out, 0, sizeof(*out));
+
+    if (a->family == AF_INET6) {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6*)out;
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port = htons(port);
+        memcpy(&sin6->sin6_addr, a->addr, 16);
+        *out_len = sizeof(*sin6);
+    } else {
+        struct sockaddr_in *sin = (struct sockaddr_in*)out;
+        sin->sin_family = AF_INET;
+        sin->sin_port = htons(port);
+        memcpy(&sin->sin_addr, a->addr, 4);
+        *out_len = sizeof(*sin);
     }
+}
 
-    /* CASO 2: host_name è un IP */
-    addr.s_addr = inet_addr(host_name);
-    if (addr.s_addr == INADDR_NONE) {
-        fprintf(stderr, "Indirizzo IP non valido: %s\n", host_name);
-        return 0;
-    }
+/*
+ * RISOLUZIONE INVERSA: serve solo per stampare il risultato, quindi viene
+ * fatta dopo lo scambio con il server e il nome ottenuto resta in cache.
+ */
+void resolve_server_name(const char *host_name, const struct sockaddr *addr, socklen_t addr_len, char *resolved_name, size_t name_len)
+{
+    if (dns_cache_get_name(host_name, resolved_name, name_len))
+        return;
 
-    *out_addr = addr;
+    if (getnameinfo(addr, addr_len, resolved_name, name_len, NULL, 0, NI_NAMEREQD) != 0)
+        snprintf(resolved_name, name_len, "%s", host_name);
 
-    strncpy(resolved_ip, host_name, ip_len - 1);
-    resolved_ip[ip_len - 1] = '\0';
+    dns_cache_put_name(host_name, resolved_name);
+}
 
-    host = gethostbyaddr((char *)&addr, sizeof(addr), AF_INET);
-    if (host != NULL) {
-        strncpy(resolved_name, host->h_name, name_len - 1);
-    } else {
-        strncpy(resolved_name, host_name, name_len - 1);
+/* Server sullo stesso host: loopback IPv4 (127/8), IPv6 (::1) o IPv4 mappato */
+int is_loopback(const struct sockaddr *addr)
+{
+    if (addr->sa_family == AF_INET)
+        return (ntohl(((const struct sockaddr_in*)addr)->sin_addr.s_addr) >> 24) == 127;
+
+    if (addr->sa_family == AF_INET6) {
+        const struct in6_addr *a6 = &((const struct sockaddr_in6*)addr)->sin6_addr;
+        return IN6_IS_ADDR_LOOPBACK(a6) || (IN6_IS_ADDR_V4MAPPED(a6) && a6->s6_addr[12] == 127);
     }
-    resolved_name[name_len - 1] = '\0';
 
-    return 1;
+    return 0;
 }
 
 
-
-
-int parse(int argc, char *argv[], char *server_ip, int *port, char *type, char *city)
+int parse(int argc, char *argv[], char *server_ip, int *port, int *force_udp, int *repeat, int *cache_ttl_ms, int *bypass_cache, char *type, char *city)
 {
     int found_r = 0;
 
@@ -173,6 +210,36 @@ int parse(int argc, char *argv[], char *server_ip, int *port, char *type, char *
             continue;
         }
 
+        /* -u: disabilita il fast path locale */
+        if (strcmp(argv[i], "-u") == 0) {
+            *force_udp = 1;
+            continue;
+        }
+
+        /* -n ripetizioni: misura latenza e throughput */
+        if (strcmp(argv[i], "-n") == 0) {
+            if (i + 1 >= argc) return 0;
+            *repeat = atoi(argv[i + 1]);
+            if (*repeat <= 0) return 0;
+            i++;
+            continue;
+        }
+
+        /* -c ttl_ms: usa la cache condivisa delle risposte */
+        if (strcmp(argv[i], "-c") == 0) {
+            if (i + 1 >= argc) return 0;
+            *cache_ttl_ms = atoi(argv[i + 1]);
+            if (*cache_ttl_ms <= 0) return 0;
+            i++;
+            continue;
+        }
+
+        /* -x: ignora le risposte in cache (la risposta nuova viene comunque salvata) */
+        if (strcmp(argv[i], "-x") == 0) {
+            *bypass_cache = 1;
+            continue;
+        }
+
         /* -r "type city" */
         if (strcmp(argv[i], "-r") == 0) {
             if (i + 1 >= argc) return 0;
@@ -227,6 +294,219 @@ int parse(int argc, char *argv[], char *server_ip, int *port, char *type, char *
 
 
 
+/* Tempo monotono in microsecondi (per il benchmark) */
+double now_us(void) {
+#if defined WIN32
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart * 1e6 / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+#endif
+}
+
+/* Socket UDP con timeout di ricezione: un indirizzo che non risponde non blocca il client */
+int udp_socket(int family) {
+    int sock = socket(family, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0)
+        return -1;
+
+#if defined WIN32
+    DWORD tv = UDP_TIMEOUT_MS;
+#else
+    struct timeval tv = { UDP_TIMEOUT_MS / 1000, (UDP_TIMEOUT_MS % 1000) * 1000 };
+#endif
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
+    return sock;
+}
+
+/*
+ * Scambio richiesta/risposta su UDP: 1 ok, 0 errore (già segnalato),
+ * -1 nessuna risposta (invio fallito o timeout)
+ */
+int udp_query(int sock, const struct sockaddr_storage *sad, socklen_t sad_len, const uint8_t buffer_req[REQ_BUFFER_SIZE], uint8_t buffer_resp[RESP_BUFFER_SIZE]) {
+
+    /* Invia richiesta al server */
+    if (sendto(sock, (const char*)buffer_req, REQ_BUFFER_SIZE, 0, (const struct sockaddr*)sad, sad_len) != REQ_BUFFER_SIZE)
+        return -1;
+
+    /* RISPOSTA SERVER */
+    struct sockaddr_storage fromAddr;
+    socklen_t fromSize = sizeof(fromAddr);
+
+    int respLen = recvfrom(sock, (char*)buffer_resp, RESP_BUFFER_SIZE, 0, (struct sockaddr*)&fromAddr, &fromSize);
+
+    if (respLen < 0)
+        return -1;
+
+    if (respLen != RESP_BUFFER_SIZE) {
+        fprintf(stderr, "Errore: dimensione risposta non valida (%d byte).\n", respLen);
+        return 0;
+    }
+
+    /* verifica che la risposta arrivi dallo stesso IP */
+    int same_source;
+    if (fromAddr.ss_family == AF_INET6)
+        same_source = sad->ss_family == AF_INET6 &&
+            memcmp(&((struct sockaddr_in6*)&fromAddr)->sin6_addr, &((const struct sockaddr_in6*)sad)->sin6_addr, sizeof(struct in6_addr)) == 0;
+    else
+        same_source = sad->ss_family == AF_INET &&
+            ((struct sockaddr_in*)&fromAddr)->sin_addr.s_addr == ((const struct sockaddr_in*)sad)->sin_addr.s_addr;
+
+    if (!same_source) {
+        fprintf(stderr, "Errore: ricevuto pacchetto da sorgente sconosciuta.\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Primo scambio UDP: prova gli indirizzi del server nell'ordine, ognuno con
+ * il proprio timeout (un server solo IPv4 non risponde su ::1). Restituisce
+ * la socket dell'indirizzo che ha risposto e in *chosen il suo indice;
+ * -1 se nessuno risponde.
+ */
+int udp_first_query(const struct sockaddr_storage sad[], const socklen_t sad_len[], int n, int *chosen,
+                    const uint8_t buffer_req[REQ_BUFFER_SIZE], uint8_t buffer_resp[RESP_BUFFER_SIZE])
+{
+    for (int a = 0; a < n; a++) {
+        int sock = udp_socket(sad[a].ss_family);
+        if (sock < 0)
+            continue;   // famiglia non supportata dall'host
+
+        int r = udp_query(sock, &sad[a], sad_len[a], buffer_req, buffer_resp);
+        if (r == 1) {
+            *chosen = a;
+            return sock;
+        }
+        closesocket(sock);
+        if (r == 0)
+            return -1;
+    }
+
+    errorhandler("Nessuna risposta dal server.\n");
+    return -1;
+}
+
+/*
+ * Scambio completo con il server: risoluzione, trasporto (locale o UDP),
+ * ripetuto repeat volte per il benchmark. 1 ok, 0 errore (già segnalato).
+ */
+int query_server(const char *server_name, int port, int force_udp, int repeat, const weather_request_t *req,
+                 weather_response_t *resp, char *server_ip_str, size_t ip_len, char *server_canonical_name, size_t name_len)
+{
+    dns_addr_t addrs[DNS_ADDR_MAX];
+    struct sockaddr_storage sad[DNS_ADDR_MAX];
+    socklen_t sad_len[DNS_ADDR_MAX];
+
+    int n_addrs = resolve_server(server_name, addrs);
+    if (n_addrs == 0)
+        return 0;
+    for (int a = 0; a < n_addrs; a++)
+        make_sockaddr(&addrs[a], port, &sad[a], &sad_len[a]);
+
+    uint8_t buffer_req[REQ_BUFFER_SIZE];
+    serialize_request(req, buffer_req);
+
+    /* FAST PATH: server sullo stesso host (loopback) */
+    int fast = FASTPATH_NONE;
+    if (!force_udp && is_loopback((struct sockaddr*)&sad[0]))
+        fast = fastpath_open(port);
+
+    uint8_t buffer_resp[RESP_BUFFER_SIZE];
+    double rtt_sum = 0.0, rtt_min = 0.0;
+    int sock = -1, chosen = 0;   // socket UDP e indirizzo che ha risposto
+
+    for (int i = 0; i < repeat; i++) {
+        double t0 = now_us();
+
+        /* in caso di errore del trasporto locale si ripiega su UDP */
+        if (fast != FASTPATH_NONE && !fastpath_query(buffer_req, buffer_resp)) {
+            fprintf(stderr, "Trasporto locale %s non disponibile, uso UDP.\n", fastpath_name());
+            fastpath_close();
+            fast = FASTPATH_NONE;
+        }
+
+        if (fast == FASTPATH_NONE) {
+            int r;
+            if (sock < 0) {
+                sock = udp_first_query(sad, sad_len, n_addrs, &chosen, buffer_req, buffer_resp);
+                r = sock >= 0;
+            } else {
+                r = udp_query(sock, &sad[chosen], sad_len[chosen], buffer_req, buffer_resp);
+                if (r < 0) errorhandler("Nessuna risposta dal server.\n");
+            }
+            if (r <= 0) {
+                if (sock >= 0) closesocket(sock);
+                return 0;
+            }
+        }
+
+        double rtt = now_us() - t0;
+        rtt_sum += rtt;
+        if (i == 0 || rtt < rtt_min) rtt_min = rtt;
+    }
+
+    if (repeat > 1)
+        printf("Benchmark: %d richieste via %s, RTT medio %.1f us, minimo %.1f us, %.0f richieste/s\n",
+               repeat, fastpath_name(), rtt_sum / repeat, rtt_min, repeat * 1e6 / rtt_sum);
+
+    fastpath_close();
+    if (sock >= 0)
+        closesocket(sock);
+
+    /* l'indirizzo che ha risposto sarà il primo da provare la prossima volta */
+    if (chosen > 0)
+        dns_cache_prefer_addr(server_name, &addrs[chosen]);
+
+    /* IP come stringa */
+    if (getnameinfo((struct sockaddr*)&sad[chosen], sad_len[chosen], server_ip_str, ip_len, NULL, 0, NI_NUMERICHOST) != 0)
+        snprintf(server_ip_str, ip_len, "%s", server_name);
+
+    deserialize_response(buffer_resp, resp);
+
+    /* Controllo status valido */
+    if (resp->status != STATUS_OK &&
+        resp->status != STATUS_CITY_UNKNOWN &&
+        resp->status != STATUS_BAD_REQUEST) {
+        printf("Errore: risposta non valida dal server.\n");
+        return 0;
+    }
+
+    /* Nome del server per l'output (risoluzione inversa pigra, in cache) */
+    resolve_server_name(server_name, (struct sockaddr*)&sad[chosen], sad_len[chosen], server_canonical_name, name_len);
+    return 1;
+}
+
+/*
+ * Risposta dalla cache condivisa, senza rete: il nome del server viene
+ * solo dalla cache DNS. Con repeat > 1 misura il tempo di lettura.
+ */
+int query_cache(const char *server_name, int port, int ttl_ms, int repeat, const weather_request_t *req,
+                weather_response_t *resp, char *server_ip_str, size_t ip_len, char *server_canonical_name, size_t name_len)
+{
+    double t0 = now_us();
+
+    for (int i = 0; i < repeat; i++) {
+        if (!resp_cache_get(server_name, port, req->type, req->city, ttl_ms, resp, server_ip_str, ip_len))
+            return 0;
+    }
+
+    if (repeat > 1) {
+        double elapsed = now_us() - t0;
+        printf("Benchmark: %d richieste via cache, tempo medio %.2f us, %.0f richieste/s\n",
+               repeat, elapsed / repeat, repeat * 1e6 / elapsed);
+    }
+
+    if (!dns_cache_get_name(server_name, server_canonical_name, name_len))
+        snprintf(server_canonical_name, name_len, "%s", server_name);
+    return 1;
+}
+
 int main(int argc, char *argv[]) {
 
 
@@ -241,6 +521,10 @@ int main(int argc, char *argv[]) {
 #endif
 
     int port;
+    int force_udp = 0;
+    int repeat = 1;
+    int cache_ttl_ms = 0;
+    int bypass_cache = 0;
     char type = 0;
     char city[CITY_MAX];
 
@@ -249,7 +533,7 @@ int main(int argc, char *argv[]) {
 
     port = SERVER_PORT;// 56700 di default
 
-    int r = parse(argc, argv, server_name, &port, &type, city);
+    int r = parse(argc, argv, server_name, &port, &force_udp, &repeat, &cache_ttl_ms, &bypass_cache, &type, city);
 
     if (r == 0) {
         print_usage(argv[0]);
@@ -262,30 +546,6 @@ int main(int argc, char *argv[]) {
     }
 
 
-    /* Risoluzione DNS del server */
-    struct in_addr server_addr_in;
-    char server_canonical_name[256];
-    char server_ip_str[64];
-
-    if (!resolve_dns(server_name,&server_addr_in,server_canonical_name, sizeof(server_canonical_name), server_ip_str, sizeof(server_ip_str))) {
-        clearwinsock();
-        return EXIT_FAILURE;
-    }
-
-    /* CREAZIONE SOCKET */
-    int sock = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    if (sock < 0) {
-        errorhandler("Creazione della socket fallita.\n");
-        clearwinsock();
-        return EXIT_FAILURE;
-    }
-
-    struct sockaddr_in sad;
-    memset(&sad, 0, sizeof(sad));
-    sad.sin_family = AF_INET;
-    sad.sin_port   = htons(port);
-    sad.sin_addr   = server_addr_in;
-
     /* RICHIESTA */
     weather_request_t req;
     memset(&req, 0, sizeof(req));
@@ -293,63 +553,35 @@ int main(int argc, char *argv[]) {
     strncpy(req.city, city, CITY_MAX - 1);
     req.city[CITY_MAX - 1] = '\0';
 
-    uint8_t buffer_req[REQ_BUFFER_SIZE];
-    serialize_request(&req, buffer_req);
-
-    /* Invia richiesta al server */
-    if (sendto(sock, (const char*)buffer_req, REQ_BUFFER_SIZE, 0, (struct sockaddr*)&sad, sizeof(sad)) != REQ_BUFFER_SIZE) {
-        errorhandler("sendto() fallita.\n");
-        closesocket(sock);
-        clearwinsock();
-        return EXIT_FAILURE;
-    }
-
-    /* RISPOSTA SERVER */
-    struct sockaddr_in fromAddr;
-#if defined WIN32
-    int fromSize = sizeof(fromAddr);
-#else
-    socklen_t fromSize = sizeof(fromAddr);
-#endif
-
-    uint8_t buffer_resp[RESP_BUFFER_SIZE];
-    int respLen = recvfrom(sock, (char*)buffer_resp, RESP_BUFFER_SIZE, 0, (struct sockaddr*)&fromAddr, &fromSize);
-
-    if (respLen < 0) {
-        errorhandler("recvfrom() fallita.\n");
-        closesocket(sock);
-        clearwinsock();
-        return EXIT_FAILURE;
-    }
-
-    if (respLen != RESP_BUFFER_SIZE) {
-        fprintf(stderr, "Errore: dimensione risposta non valida (%d byte).\n", respLen);
-        closesocket(sock);
-        clearwinsock();
-        return EXIT_FAILURE;
-    }
-
-    /* verifica che la risposta arrivi dallo stesso IP */
-    if (fromAddr.sin_addr.s_addr != sad.sin_addr.s_addr) {
-        fprintf(stderr, "Errore: ricevuto pacchetto da sorgente sconosciuta.\n");
-        closesocket(sock);
-        clearwinsock();
-        return EXIT_FAILURE;
-    }
+    /* Cache DNS e cache delle risposte (entrambe facoltative) */
+    dns_cache_open();
+    if (cache_ttl_ms > 0)
+        resp_cache_open();
 
     weather_response_t resp;
-    deserialize_response(buffer_resp, &resp);
+    char server_ip_str[64];
+    char server_canonical_name[NI_MAXHOST];
+
+    int hit = cache_ttl_ms > 0 && !bypass_cache &&
+        query_cache(server_name, port, cache_ttl_ms, repeat, &req, &resp,
+                    server_ip_str, sizeof(server_ip_str), server_canonical_name, sizeof(server_canonical_name));
+
+    if (!hit) {
+        if (!query_server(server_name, port, force_udp, repeat, &req, &resp,
+                          server_ip_str, sizeof(server_ip_str), server_canonical_name, sizeof(server_canonical_name))) {
+            resp_cache_close();
+            dns_cache_close();
+            clearwinsock();
+            return EXIT_FAILURE;
+        }
 
-    /* Controllo status valido */
-    if (resp.status != STATUS_OK &&
-        resp.status != STATUS_CITY_UNKNOWN &&
-        resp.status != STATUS_BAD_REQUEST) {
-        printf("Errore: risposta non valida dal server.\n");
-        closesocket(sock);
-        clearwinsock();
-        return EXIT_FAILURE;
+        if (cache_ttl_ms > 0)
+            resp_cache_put(server_name, port, req.type, req.city, &resp, server_ip_str);
     }
 
+    resp_cache_close();
+    dns_cache_close();
+
     /* Formatta città */
     maiuscola(city);
 
@@ -383,7 +615,6 @@ int main(int argc, char *argv[]) {
 
     /* CHIUSURA CLIENT */
 	printf("Client terminated.\n");
-	closesocket(sock);
 	clearwinsock();
 	return 0;
 }
@@ -19,6 +19,7 @@
 #define SERVER_PORT 56700
 #define DEFAULT_HOST "localhost"
 #define CITY_MAX 64
+#define CITY_COUNT 10
 
 
 #define TYPE_TEMP  't'
@@ -35,6 +36,30 @@
 #define REQ_BUFFER_SIZE (sizeof(char) + CITY_MAX)
 #define RESP_BUFFER_SIZE (sizeof(uint32_t) + sizeof(char) + sizeof(float))
 
+/*
+ * ============================================================================
+ * FAST PATH LOCALE (client e server sullo stesso host)
+ * ============================================================================
+ */
+
+/* Endpoint AF_UNIX SOCK_DGRAM del server (uno per porta UDP) */
+#define UNIX_SOCKET_FMT "/tmp/weather_%d.sock"
+
+/* Ring di richieste/risposte in memoria condivisa POSIX (uno per porta UDP) */
+#define SHM_RING_FMT     "/weather_ring_%d"
+#define SHM_RING_MAGIC   0x574E5232u     // "WRN2"
+#define SHM_RING_SLOTS   64
+#define SHM_SLOT_SIZE    128             // uno slot per linea di cache (x2)
+#define SHM_TIMEOUT_MS   1000            // attesa massima del client sulla risposta
+#define SHM_REAP_MS      1000            // intervallo del server tra due recuperi di slot
+
+/* Stati di uno slot del ring */
+#define SLOT_FREE      0
+#define SLOT_CLAIMED   1                 // client sta scrivendo la richiesta
+#define SLOT_REQUEST   2                 // richiesta pronta per il server
+#define SLOT_SERVING   3                 // server in elaborazione
+#define SLOT_RESPONSE  4                 // risposta pronta per il client
+
 /*
  * ============================================================================
  * PROTOCOL DATA STRUCTURES
@@ -54,6 +79,30 @@ typedef struct {
     float value;                 // valore meteo
 } weather_response_t;
 
+/*
+ * Slot del ring: trasporta gli stessi buffer serializzati usati su UDP,
+ * quindi il formato di rete resta identico su tutti i trasporti.
+ * owner_pid e claimed_ms permettono al server di recuperare gli slot di
+ * client terminati senza liberarli (owner_pid = 0 finché non è scritto).
+ */
+typedef struct {
+    uint32_t state;                           // SLOT_* (futex)
+    uint32_t owner_pid;                       // client che ha preso lo slot
+    uint32_t claimed_ms;                      // CLOCK_MONOTONIC in ms, modulo 2^32
+    uint8_t req[REQ_BUFFER_SIZE];
+    uint8_t resp[RESP_BUFFER_SIZE];
+    uint8_t pad[SHM_SLOT_SIZE - 3 * sizeof(uint32_t) - REQ_BUFFER_SIZE - RESP_BUFFER_SIZE];
+} shm_slot_t;
+
+typedef struct {
+    uint32_t magic;                           // SHM_RING_MAGIC quando il server è pronto
+    uint32_t server_pid;
+    uint32_t doorbell;                        // incrementato ad ogni richiesta (futex)
+    uint32_t server_waiting;                  // 1 se il server dorme sul doorbell
+    uint8_t pad[SHM_SLOT_SIZE - 4 * sizeof(uint32_t)];
+    shm_slot_t slots[SHM_RING_SLOTS];
+} shm_ring_t;
+
 /*
  * ============================================================================
  * FUNCTION PROTOTYPES
@@ -65,4 +114,10 @@ float get_humidity(void);
 float get_wind(void);
 float get_pressure(void);
 
+extern const char *city_list[CITY_COUNT];
+
+void deserialize_request(const uint8_t buffer[REQ_BUFFER_SIZE], weather_request_t *req);
+void serialize_response(const weather_response_t *resp, uint8_t buffer[RESP_BUFFER_SIZE]);
+void process_request(const weather_request_t *req, weather_response_t *resp);
+
 #endif /* PROTOCOL_H_ */
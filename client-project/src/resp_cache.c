@@ -0,0 +1,260 @@
+/*
+ * resp_cache.c
+ *
+ * Cache delle risposte su file mappato.
+ *
+ * Ogni voce è protetta da un numero di sequenza: dispari durante una
+ * scrittura. Uno scrittore lo porta da pari a dispari con una CAS (se
+ * fallisce rinuncia: un altro processo sta già scrivendo), aggiorna la voce
+ * e lo riporta pari. Un lettore copia la voce e la considera valida solo se
+ * la sequenza è pari e invariata prima e dopo la copia.
+ *
+ * La stessa parola a 64 bit porta, mentre la sequenza è dispari, il PID
+ * dello scrittore: se il processo muore a metà scrittura la voce resterebbe
+ * dispari per sempre, quindi uno scrittore successivo che trova il PID non
+ * più esistente se ne riappropria con una CAS e la riscrive per intero.
+ *
+ * Il file è privato dell'utente (vedi cache_file.h), ma resta scritto da
+ * altri processi senza coordinamento: una voce letta si tratta come dato
+ * non fidato e si usa solo se ha una forma plausibile.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "resp_cache.h"
+#include "cache_file.h"
+
+#if defined WIN32
+
+int resp_cache_open(void) { return 0; }
+int resp_cache_get(const char *server, int port, char type, const char *city, int ttl_ms,
+                   weather_response_t *resp, char *server_ip, size_t ip_len)
+{ (void)server; (void)port; (void)type; (void)city; (void)ttl_ms; (void)resp; (void)server_ip; (void)ip_len; return 0; }
+void resp_cache_put(const char *server, int port, char type, const char *city,
+                    const weather_response_t *resp, const char *server_ip)
+{ (void)server; (void)port; (void)type; (void)city; (void)resp; (void)server_ip; }
+void resp_cache_close(void) { }
+
+#else
+
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <signal.h>
+
+typedef struct {
+    char server[RESP_SERVER_MAX];       // nome del server in minuscolo
+    int32_t port;
+    char type;
+    char city[CITY_MAX];                // città in minuscolo
+} resp_key_t;
+
+typedef struct {
+    uint64_t seq;                       // seqlock: PID dello scrittore << 32 | sequenza
+    uint32_t hash;                      // 0 = voce mai usata
+    uint32_t pad;
+    int64_t stored_ms;                  // istante di inserimento (CLOCK_REALTIME)
+    resp_key_t key;
+    weather_response_t resp;
+    char server_ip[RESP_IP_MAX];
+} resp_entry_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t entry_size;                // cambia se cambia il formato
+    resp_entry_t entries[RESP_CACHE_SLOTS];
+} resp_cache_file_t;
+
+static resp_cache_file_t *cache = NULL;
+
+int resp_cache_open(void) {
+    if (cache != NULL) return 1;
+
+    /* solo la creazione del file è serializzata; l'accesso alle voci è senza lock */
+    int fd = cache_file_open(RESP_CACHE_NAME, sizeof(resp_cache_file_t));
+    if (fd < 0)
+        return 0;
+
+    void *mem = mmap(NULL, sizeof(resp_cache_file_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED) {
+        flock(fd, LOCK_UN);
+        close(fd);
+        return 0;
+    }
+    cache = (resp_cache_file_t*)mem;
+
+    if (cache->magic != RESP_CACHE_MAGIC || cache->entry_size != sizeof(resp_entry_t)) {
+        memset(cache, 0, sizeof(*cache));
+        cache->entry_size = sizeof(resp_entry_t);
+        __atomic_store_n(&cache->magic, RESP_CACHE_MAGIC, __ATOMIC_RELEASE);
+    }
+
+    flock(fd, LOCK_UN);
+    close(fd);
+    return 1;
+}
+
+void resp_cache_close(void) {
+    if (cache == NULL) return;
+    munmap(cache, sizeof(resp_cache_file_t));
+    cache = NULL;
+}
+
+static int64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Chiave normalizzata (zeri dopo i terminatori) e suo hash FNV-1a, mai 0 */
+static int make_key(const char *server, int port, char type, const char *city, resp_key_t *key, uint32_t *hash) {
+    if (strlen(server) >= RESP_SERVER_MAX || strlen(city) >= CITY_MAX)
+        return 0;
+
+    memset(key, 0, sizeof(*key));
+    for (size_t i = 0; server[i]; i++)
+        key->server[i] = (char)tolower((unsigned char)server[i]);
+    for (size_t i = 0; city[i]; i++)
+        key->city[i] = (char)tolower((unsigned char)city[i]);
+    key->port = port;
+    key->type = type;
+
+    uint32_t h = 2166136261u;
+    const unsigned char *p = (const unsigned char*)key;
+    for (size_t i = 0; i < sizeof(*key); i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    *hash = h ? h : 1;
+    return 1;
+}
+
+/* Copia coerente di una voce; 0 se è in corso una scrittura */
+static int read_entry(resp_entry_t *e, resp_entry_t *out) {
+    uint64_t s1 = __atomic_load_n(&e->seq, __ATOMIC_ACQUIRE);
+    if (s1 & 1) return 0;
+
+    memcpy(out, e, sizeof(*out));
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&e->seq, __ATOMIC_RELAXED) == s1;
+}
+
+int resp_cache_get(const char *server, int port, char type, const char *city, int ttl_ms,
+                   weather_response_t *resp, char *server_ip, size_t ip_len) {
+    resp_key_t key;
+    uint32_t hash;
+    if (cache == NULL || !make_key(server, port, type, city, &key, &hash))
+        return 0;
+
+    int64_t now = now_ms();
+    for (uint32_t i = 0; i < RESP_CACHE_PROBES; i++) {
+        resp_entry_t *e = &cache->entries[(hash + i) & (RESP_CACHE_SLOTS - 1)];
+        resp_entry_t copy;
+
+        if (__atomic_load_n(&e->hash, __ATOMIC_RELAXED) != hash || !read_entry(e, &copy))
+            continue;
+        if (copy.hash != hash || memcmp(&copy.key, &key, sizeof(key)) != 0)
+            continue;
+        /* scaduta o non plausibile: la stessa chiave può comparire più avanti
+           (scritta da un processo che non ha visto questa voce) */
+        if (now - copy.stored_ms >= ttl_ms || now < copy.stored_ms)
+            continue;
+        if (copy.resp.status == STATUS_OK ? copy.resp.type != type : copy.resp.status != STATUS_CITY_UNKNOWN)
+            continue;
+
+        copy.server_ip[RESP_IP_MAX - 1] = '\0';
+
+        *resp = copy.resp;
+        snprintf(server_ip, ip_len, "%s", copy.server_ip);
+        return 1;
+    }
+    return 0;
+}
+
+/* Voce lasciata dispari da uno scrittore che non esiste più */
+static int writer_dead(resp_entry_t *e) {
+    uint64_t seq = __atomic_load_n(&e->seq, __ATOMIC_RELAXED);
+    if (!(seq & 1)) return 0;
+
+    pid_t pid = (pid_t)(seq >> 32);
+    if (pid <= 0) return 1;   // mai scritto da resp_cache_put: voce corrotta
+    return kill(pid, 0) < 0 && errno == ESRCH;
+}
+
+/*
+ * Porta la sequenza a dispari registrando il PID; da dispari solo se lo
+ * scrittore è morto. Restituisce 0 se un altro processo sta scrivendo.
+ */
+static int lock_entry(resp_entry_t *e, uint32_t *locked) {
+    uint64_t seq = __atomic_load_n(&e->seq, __ATOMIC_RELAXED);
+    uint32_t n = (uint32_t)seq;
+
+    if ((n & 1) && !writer_dead(e))
+        return 0;
+    n += (n & 1) ? 2 : 1;
+
+    uint64_t next = ((uint64_t)(uint32_t)getpid() << 32) | n;
+    if (!__atomic_compare_exchange_n(&e->seq, &seq, next, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return 0;
+    *locked = n;
+    return 1;
+}
+
+void resp_cache_put(const char *server, int port, char type, const char *city,
+                    const weather_response_t *resp, const char *server_ip) {
+    resp_key_t key;
+    uint32_t hash;
+    if (cache == NULL || !make_key(server, port, type, city, &key, &hash))
+        return;
+    if (resp->status != STATUS_OK && resp->status != STATUS_CITY_UNKNOWN)
+        return;
+
+    /* stessa chiave, altrimenti una voce abbandonata, una libera o la più vecchia */
+    resp_entry_t *victim = NULL, *stuck = NULL;
+    int found = 0;
+    for (uint32_t i = 0; i < RESP_CACHE_PROBES; i++) {
+        resp_entry_t *e = &cache->entries[(hash + i) & (RESP_CACHE_SLOTS - 1)];
+        resp_entry_t copy;
+
+        if (!read_entry(e, &copy)) {
+            if (stuck == NULL && writer_dead(e))
+                stuck = e;
+            continue;
+        }
+        if (copy.hash == hash && memcmp(&copy.key, &key, sizeof(key)) == 0) {
+            victim = e;
+            found = 1;
+            break;
+        }
+        if (victim == NULL || copy.hash == 0 || copy.stored_ms < victim->stored_ms)
+            victim = e;
+        if (copy.hash == 0)
+            break;
+    }
+    if (!found && stuck != NULL)
+        victim = stuck;
+    if (victim == NULL)
+        return;
+
+    uint32_t seq;
+    if (!lock_entry(victim, &seq))
+        return;   // un altro processo sta scrivendo questa voce
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    victim->key = key;
+    victim->resp = *resp;
+    snprintf(victim->server_ip, sizeof(victim->server_ip), "%s", server_ip);
+    victim->stored_ms = now_ms();
+    __atomic_store_n(&victim->hash, hash, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&victim->seq, (uint64_t)(seq + 1), __ATOMIC_RELEASE);
+}
+
+#endif /* WIN32 */
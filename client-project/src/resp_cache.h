@@ -0,0 +1,37 @@
+/*
+ * resp_cache.h
+ *
+ * Cache delle risposte condivisa dai processi client dello stesso utente:
+ * tabella hash in un file mappato in memoria, senza lock (seqlock per voce),
+ * indicizzata da (server, porta, tipo, città in minuscolo).
+ */
+
+#ifndef RESP_CACHE_H_
+#define RESP_CACHE_H_
+
+#include "protocol.h"
+
+#define RESP_CACHE_NAME   "weather_resp_cache" // file per utente, vedi cache_file.h
+#define RESP_CACHE_MAGIC  0x57524350u     // "WRCP"
+#define RESP_CACHE_SLOTS  1024            // potenza di 2
+#define RESP_CACHE_PROBES 8               // voci esaminate per chiave
+#define RESP_SERVER_MAX   64
+#define RESP_IP_MAX       64
+
+/* Apre (o crea) il file della cache; 0 se non disponibile */
+int resp_cache_open(void);
+
+/*
+ * Risposta in cache più recente di ttl_ms millisecondi: 1 trovata, 0 assente.
+ * server_ip riceve l'IP del server che aveva risposto.
+ */
+int resp_cache_get(const char *server, int port, char type, const char *city, int ttl_ms,
+                   weather_response_t *resp, char *server_ip, size_t ip_len);
+
+/* Salva la risposta (solo STATUS_OK e, come cache negativa, STATUS_CITY_UNKNOWN) */
+void resp_cache_put(const char *server, int port, char type, const char *city,
+                    const weather_response_t *resp, const char *server_ip);
+
+void resp_cache_close(void);
+
+#endif /* RESP_CACHE_H_ */
@@ -0,0 +1,75 @@
+/*
+ * hash_ring.c
+ *
+ * Anello ordinato di (hash, backend) con ricerca binaria.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hash_ring.h"
+
+typedef struct {
+    uint32_t hash;
+    int backend;
+} ring_point_t;
+
+static ring_point_t points[RING_MAX_BACKENDS * RING_VNODES];
+static int n_points = 0;
+
+uint32_t ring_hash(const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t*)data;
+    uint32_t h = 2166136261u;
+
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+
+    /* FNV da solo distribuisce male stringhe quasi uguali ("b#1", "b#2") */
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static int cmp_point(const void *a, const void *b) {
+    const ring_point_t *pa = (const ring_point_t*)a, *pb = (const ring_point_t*)b;
+    if (pa->hash != pb->hash) return pa->hash < pb->hash ? -1 : 1;
+    return pa->backend - pb->backend;
+}
+
+void ring_build(const char *const names[], const int alive[], int n) {
+    char vnode[128];
+
+    n_points = 0;
+    for (int b = 0; b < n && b < RING_MAX_BACKENDS; b++) {
+        if (!alive[b]) continue;
+        for (int v = 0; v < RING_VNODES; v++) {
+            int len = snprintf(vnode, sizeof(vnode), "%s#%d", names[b], v);
+            points[n_points].hash = ring_hash(vnode, (size_t)len);
+            points[n_points].backend = b;
+            n_points++;
+        }
+    }
+    qsort(points, (size_t)n_points, sizeof(points[0]), cmp_point);
+}
+
+int ring_lookup(uint32_t key_hash, int exclude) {
+    if (n_points == 0) return -1;
+
+    /* primo punto con hash >= key_hash; oltre l'ultimo si riparte dal primo */
+    int lo = 0, hi = n_points;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (points[mid].hash < key_hash) lo = mid + 1;
+        else hi = mid;
+    }
+    for (int i = 0; i < n_points; i++) {
+        int b = points[(lo + i) % n_points].backend;
+        if (b != exclude) return b;
+    }
+    return -1;
+}
@@ -0,0 +1,34 @@
+/*
+ * hash_ring.h
+ *
+ * Hashing consistente delle città sui server di backend: ogni backend vivo
+ * occupa RING_VNODES punti sull'anello, una chiave appartiene al primo punto
+ * che la segue. Se un backend cade solo le sue chiavi cambiano proprietario.
+ */
+
+#ifndef HASH_RING_H_
+#define HASH_RING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RING_MAX_BACKENDS 16
+#define RING_VNODES       128             // punti per backend
+
+/* Hash a 32 bit (FNV-1a con rimescolamento finale) */
+uint32_t ring_hash(const void *data, size_t len);
+
+/*
+ * Ricostruisce l'anello con i soli backend vivi (alive[i] != 0).
+ * names[i] identifica il backend i: stesso nome, stessi punti.
+ */
+void ring_build(const char *const names[], const int alive[], int n);
+
+/*
+ * Backend proprietario della chiave, -1 se nessun backend è vivo.
+ * Con exclude >= 0 salta quel backend e restituisce il successivo sull'anello
+ * (nuovo tentativo dopo un timeout).
+ */
+int ring_lookup(uint32_t key_hash, int exclude);
+
+#endif /* HASH_RING_H_ */
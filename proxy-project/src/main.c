@@ -0,0 +1,865 @@
+/*
+ * main.c
+ *
+ * Proxy UDP con cache davanti a più server meteo.
+ *
+ * Verso i client parla lo stesso protocollo del server. Le richieste sono
+ * ripartite sui backend con hashing consistente sulla città in minuscolo:
+ * la stessa città va sempre allo stesso server finché questo è vivo.
+ * Richieste identiche già in volo vengono accorpate in un solo inoltro e le
+ * coppie (tipo, città) più richieste sono servite da una cache con TTL.
+ * Un backend che non risponde viene tolto dall'anello (le sue città passano
+ * ai successivi) e sondato periodicamente finché non torna.
+ */
+
+#if defined WIN32
+/* il default di Winsock (64 socket per fd_set) è sotto le richieste in volo */
+#define FD_SETSIZE 1024
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/wait.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#define closesocket close
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string.h>
+#include <signal.h>
+#include "protocol.h"
+#include "hash_ring.h"
+
+#define NO_ERROR 0
+
+#define PROXY_MAX_PENDING    256           // richieste distinte in volo
+#define PROXY_MAX_WAITERS    32            // client in attesa della stessa risposta
+#define PROXY_IDLE_SOCKS     16            // socket riutilizzabili per backend
+#define PROXY_CACHE_SLOTS    4096          // potenza di 2
+#define PROXY_CACHE_PROBES   8             // voci esaminate per chiave
+#define PROXY_CACHE_TTL_MS   1000
+#define PROXY_MAX_WORKERS    16
+#define PROXY_RECV_BATCH     64            // datagrammi letti per risveglio
+
+#define BACKEND_TIMEOUT_MS   300           // attesa della risposta di un backend
+#define BACKEND_MAX_FAILS    3             // timeout consecutivi prima di toglierlo
+#define BACKEND_PROBE_MS     1000          // intervallo tra le sonde a un backend morto
+#define REQUEST_MAX_TRIES    2             // inoltri per richiesta (il secondo al nuovo proprietario)
+#define PROBE_CITY           "bari"        // richiesta valida per le sonde (niente BAD_REQUEST nei log)
+
+/*
+ * select() vede al più FD_SETSIZE socket (su POSIX: descrittori < FD_SETSIZE).
+ * Il caso peggiore è la socket verso i client, una per richiesta in volo, una
+ * sonda e PROXY_IDLE_SOCKS socket inattive per backend, più stdin/out/err.
+ */
+#if 4 + PROXY_MAX_PENDING + RING_MAX_BACKENDS * (PROXY_IDLE_SOCKS + 1) > FD_SETSIZE
+#error "PROXY_MAX_PENDING troppo grande per FD_SETSIZE"
+#endif
+
+void clearwinsock() {
+#if defined WIN32
+	WSACleanup();
+#endif
+}
+
+void errorhandler(const char *errorMessage){
+    fprintf(stderr, "%s", errorMessage);
+}
+
+/* OPZIONI */
+
+typedef struct {
+    int port;
+    const char *backends[RING_MAX_BACKENDS];  // -b host[:porta]
+    int n_backends;
+    int ttl_ms;                               // -t, 0 = cache disattivata
+    int workers;                              // -w
+    int stats_interval;                       // -S
+} proxy_options_t;
+
+int parse_args(int argc, char *argv[], proxy_options_t *opt) {
+
+    for (int i = 1; i < argc; i++) {
+
+        if (i + 1 >= argc || argv[i + 1][0] == '-') return 0;
+
+        /* -b host[:porta]: server di backend (ripetibile) */
+        if (strcmp(argv[i], "-b") == 0) {
+            if (opt->n_backends >= RING_MAX_BACKENDS) return 0;
+            opt->backends[opt->n_backends++] = argv[++i];
+            continue;
+        }
+
+        /* -p porta: porta UDP del proxy */
+        if (strcmp(argv[i], "-p") == 0) {
+            opt->port = atoi(argv[++i]);
+            if (opt->port <= 0 || opt->port > 65535) return 0;
+            continue;
+        }
+
+        /* -t ms: TTL della cache delle risposte (0 la disattiva) */
+        if (strcmp(argv[i], "-t") == 0) {
+            if (!isdigit((unsigned char)argv[i + 1][0])) return 0;
+            opt->ttl_ms = atoi(argv[++i]);
+            continue;
+        }
+
+        /* -w n: processi worker sulla stessa porta (SO_REUSEPORT) */
+        if (strcmp(argv[i], "-w") == 0) {
+            opt->workers = atoi(argv[++i]);
+            if (opt->workers <= 0 || opt->workers > PROXY_MAX_WORKERS) return 0;
+            continue;
+        }
+
+        /* -S secondi: stampa periodica delle statistiche */
+        if (strcmp(argv[i], "-S") == 0) {
+            opt->stats_interval = atoi(argv[++i]);
+            if (opt->stats_interval <= 0) return 0;
+            continue;
+        }
+
+        return 0;
+    }
+
+    return opt->n_backends > 0;
+}
+
+/* OROLOGIO MONOTONO */
+
+static int64_t now_ms(void) {
+#if defined WIN32
+    return (int64_t)GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+/*
+ * Errore dell'ultima operazione su una socket attribuibile al backend
+ * (porta chiusa, host irraggiungibile). Le risorse locali esaurite
+ * (EMFILE, ENOBUFS, EAGAIN...) non dicono nulla sulla sua salute.
+ */
+static int backend_error(void) {
+#if defined WIN32
+    int err = WSAGetLastError();
+    return err == WSAECONNRESET || err == WSAECONNREFUSED || err == WSAEHOSTUNREACH || err == WSAENETUNREACH;
+#else
+    return errno == ECONNREFUSED || errno == EHOSTUNREACH || errno == ENETUNREACH;
+#endif
+}
+
+static void set_nonblocking(int sock) {
+#if defined WIN32
+    u_long on = 1;
+    ioctlsocket(sock, FIONBIO, &on);
+#else
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+/*
+ * ============================================================================
+ * BACKEND
+ * ============================================================================
+ */
+
+typedef struct {
+    char name[96];                       // host:porta come da riga di comando
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    int alive;
+    int failures;                        // timeout consecutivi
+    int idle[PROXY_IDLE_SOCKS];          // socket connesse senza risposte pendenti
+    int n_idle;
+    int probe_sock;                      // -1 se nessuna sonda in corso
+    int64_t probe_at_ms;                 // prossima sonda o scadenza di quella in corso
+} backend_t;
+
+static backend_t backends[RING_MAX_BACKENDS];
+static int n_backends = 0;
+
+/* host[:porta] oppure [ipv6]:porta; porta predefinita SERVER_PORT */
+static int backend_resolve(const char *spec, backend_t *b) {
+    char host[128], port[16];
+    const char *colon;
+
+    snprintf(port, sizeof(port), "%d", SERVER_PORT);
+    if (spec[0] == '[') {
+        const char *end = strchr(spec, ']');
+        if (end == NULL) return 0;
+        snprintf(host, sizeof(host), "%.*s", (int)(end - spec - 1), spec + 1);
+        if (end[1] == ':') snprintf(port, sizeof(port), "%s", end + 2);
+    } else if ((colon = strrchr(spec, ':')) != NULL && strchr(spec, ':') == colon) {
+        snprintf(host, sizeof(host), "%.*s", (int)(colon - spec), spec);
+        snprintf(port, sizeof(port), "%s", colon + 1);
+    } else {
+        snprintf(host, sizeof(host), "%s", spec);
+    }
+
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_protocol = IPPROTO_UDP;
+
+    int err = getaddrinfo(host, port, &hints, &res);
+    if (err != 0 || res == NULL) {
+        fprintf(stderr, "getaddrinfo() failed for %s: %s\n", spec, gai_strerror(err));
+        return 0;
+    }
+
+    memset(b, 0, sizeof(*b));
+    snprintf(b->name, sizeof(b->name), "%s", spec);
+    memcpy(&b->addr, res->ai_addr, res->ai_addrlen);
+    b->addr_len = (socklen_t)res->ai_addrlen;
+    b->alive = 1;
+    b->probe_sock = -1;
+    freeaddrinfo(res);
+    return 1;
+}
+
+static void rebuild_ring(void) {
+    const char *names[RING_MAX_BACKENDS];
+    int alive[RING_MAX_BACKENDS];
+
+    for (int i = 0; i < n_backends; i++) {
+        names[i] = backends[i].name;
+        alive[i] = backends[i].alive;
+    }
+    ring_build(names, alive, n_backends);
+}
+
+/*
+ * Socket connessa al backend: ogni richiesta in volo ne ha una propria, così
+ * la risposta (che non contiene la città) si abbina senza ambiguità.
+ */
+static int backend_socket(int b) {
+    backend_t *be = &backends[b];
+
+    if (be->n_idle > 0)
+        return be->idle[--be->n_idle];
+
+    int sock = socket(be->addr.ss_family, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) return -1;
+    if (connect(sock, (struct sockaddr*)&be->addr, (int)be->addr_len) < 0) {
+        closesocket(sock);
+        return -1;
+    }
+    set_nonblocking(sock);
+    return sock;
+}
+
+/* Restituisce una socket la cui risposta è già arrivata */
+static void backend_release(int b, int sock) {
+    backend_t *be = &backends[b];
+
+    if (be->alive && be->n_idle < PROXY_IDLE_SOCKS)
+        be->idle[be->n_idle++] = sock;
+    else
+        closesocket(sock);
+}
+
+static void backend_down(int b, int64_t now) {
+    backend_t *be = &backends[b];
+
+    be->alive = 0;
+    while (be->n_idle > 0)
+        closesocket(be->idle[--be->n_idle]);
+    be->probe_at_ms = now + BACKEND_PROBE_MS;
+    rebuild_ring();
+    printf("Backend %s non risponde: le sue città passano agli altri server.\n", be->name);
+}
+
+static void backend_up(int b) {
+    backend_t *be = &backends[b];
+
+    be->alive = 1;
+    be->failures = 0;
+    rebuild_ring();
+    printf("Backend %s di nuovo attivo.\n", be->name);
+}
+
+/* hard: errore esplicito (es. ICMP port unreachable), basta una volta */
+static void backend_failed(int b, int64_t now, int hard) {
+    backend_t *be = &backends[b];
+
+    be->failures++;
+    if (be->alive && (hard || be->failures >= BACKEND_MAX_FAILS))
+        backend_down(b, now);
+}
+
+/*
+ * ============================================================================
+ * CACHE DELLE RISPOSTE
+ * ============================================================================
+ */
+
+typedef struct {
+    uint32_t hash;                       // 0 = voce mai usata
+    int64_t expires_ms;
+    uint8_t key[REQ_BUFFER_SIZE];        // richiesta normalizzata
+    uint8_t resp[RESP_BUFFER_SIZE];
+} cache_entry_t;
+
+static cache_entry_t *cache = NULL;
+static int cache_ttl_ms = 0;
+
+static int cache_get(const uint8_t key[REQ_BUFFER_SIZE], uint32_t hash, int64_t now, uint8_t resp[RESP_BUFFER_SIZE]) {
+    if (cache == NULL) return 0;
+
+    for (int i = 0; i < PROXY_CACHE_PROBES; i++) {
+        cache_entry_t *e = &cache[(hash + i) & (PROXY_CACHE_SLOTS - 1)];
+        if (e->hash == hash && e->expires_ms > now && memcmp(e->key, key, REQ_BUFFER_SIZE) == 0) {
+            memcpy(resp, e->resp, RESP_BUFFER_SIZE);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void cache_put(const uint8_t key[REQ_BUFFER_SIZE], uint32_t hash, int64_t now, const uint8_t resp[RESP_BUFFER_SIZE]) {
+    if (cache == NULL) return;
+
+    /* solo risposte valide e, come cache negativa, città sconosciute */
+    uint32_t status;
+    memcpy(&status, resp, sizeof(status));
+    status = ntohl(status);
+    if (status != STATUS_OK && status != STATUS_CITY_UNKNOWN) return;
+
+    /* stessa chiave, altrimenti la voce che scade prima */
+    cache_entry_t *victim = NULL;
+    for (int i = 0; i < PROXY_CACHE_PROBES; i++) {
+        cache_entry_t *e = &cache[(hash + i) & (PROXY_CACHE_SLOTS - 1)];
+        if (e->hash == hash && memcmp(e->key, key, REQ_BUFFER_SIZE) == 0) {
+            victim = e;
+            break;
+        }
+        if (victim == NULL || e->expires_ms < victim->expires_ms)
+            victim = e;
+    }
+
+    victim->hash = hash;
+    victim->expires_ms = now + cache_ttl_ms;
+    memcpy(victim->key, key, REQ_BUFFER_SIZE);
+    memcpy(victim->resp, resp, RESP_BUFFER_SIZE);
+}
+
+/*
+ * ============================================================================
+ * RICHIESTE IN VOLO
+ * ============================================================================
+ */
+
+typedef struct {
+    int sock;                            // -1 = voce libera
+    int backend;
+    int tries;
+    int64_t deadline_ms;
+    uint32_t hash;                       // hash della richiesta normalizzata
+    uint32_t city_hash;                  // posizione sull'anello
+    uint8_t key[REQ_BUFFER_SIZE];
+    int n_waiters;
+    struct sockaddr_storage waiters[PROXY_MAX_WAITERS];
+    socklen_t waiter_len[PROXY_MAX_WAITERS];
+} pending_t;
+
+static pending_t pending[PROXY_MAX_PENDING];
+
+/* STATISTICHE */
+static unsigned long long st_requests, st_hits, st_coalesced, st_forwarded, st_dropped;
+
+/* Chiave di cache e coalescenza: la richiesta con la città in minuscolo */
+static void normalize_request(const uint8_t in[REQ_BUFFER_SIZE], uint8_t out[REQ_BUFFER_SIZE]) {
+    int ended = 0;
+
+    out[0] = in[0];
+    for (size_t i = 1; i < REQ_BUFFER_SIZE; i++) {
+        out[i] = ended ? 0 : (uint8_t)tolower(in[i]);
+        if (in[i] == '\0') ended = 1;
+    }
+}
+
+static pending_t *pending_find(const uint8_t key[REQ_BUFFER_SIZE], uint32_t hash) {
+    for (int i = 0; i < PROXY_MAX_PENDING; i++) {
+        pending_t *p = &pending[i];
+        if (p->sock >= 0 && p->hash == hash && memcmp(p->key, key, REQ_BUFFER_SIZE) == 0)
+            return p;
+    }
+    return NULL;
+}
+
+static pending_t *pending_alloc(void) {
+    for (int i = 0; i < PROXY_MAX_PENDING; i++)
+        if (pending[i].sock < 0)
+            return &pending[i];
+    return NULL;
+}
+
+/*
+ * Inoltra la richiesta al proprietario attuale della città (o al successivo
+ * se il proprietario è exclude): 1 ok, 0 nessun backend
+ */
+static int pending_send(pending_t *p, int64_t now, int exclude) {
+    for (;;) {
+        int b = ring_lookup(p->city_hash, exclude);
+        if (b < 0) return 0;
+
+        int sock = backend_socket(b);
+        if (sock >= 0 && send(sock, (const char*)p->key, REQ_BUFFER_SIZE, 0) == REQ_BUFFER_SIZE) {
+            p->sock = sock;
+            p->backend = b;
+            p->tries++;
+            p->deadline_ms = now + BACKEND_TIMEOUT_MS;
+            st_forwarded++;
+            return 1;
+        }
+
+        int remote = backend_error();
+        if (sock >= 0) closesocket(sock);
+
+        /* risorse locali esaurite: fallisce solo questa richiesta, i backend restano */
+        if (!remote) return 0;
+
+        /* backend irraggiungibile: lo si toglie e si riprova sul successivo */
+        backend_failed(b, now, 1);
+    }
+}
+
+/* Nuovo tentativo su un altro backend, oppure rinuncia (i client non ricevono nulla) */
+static void pending_retry(pending_t *p, int64_t now) {
+    p->sock = -1;
+    if (p->tries < REQUEST_MAX_TRIES && pending_send(p, now, p->backend))
+        return;
+    st_dropped += (unsigned long long)p->n_waiters;
+}
+
+/* RISPOSTA DI UN BACKEND */
+static void handle_backend(int front, pending_t *p, int64_t now) {
+    uint8_t resp[RESP_BUFFER_SIZE];
+    int b = p->backend;
+
+    int len = recv(p->sock, (char*)resp, RESP_BUFFER_SIZE, 0);
+    if (len < 0) {
+#if !defined WIN32
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return;
+#endif
+        /* porta chiusa sul backend: il server non è in esecuzione */
+        int remote = backend_error();
+        closesocket(p->sock);
+        if (remote) backend_failed(b, now, 1);
+        pending_retry(p, now);
+        return;
+    }
+    if (len != RESP_BUFFER_SIZE) return;
+
+    for (int i = 0; i < p->n_waiters; i++)
+        sendto(front, (const char*)resp, RESP_BUFFER_SIZE, 0, (struct sockaddr*)&p->waiters[i], (int)p->waiter_len[i]);
+
+    cache_put(p->key, p->hash, now, resp);
+    backends[b].failures = 0;
+    backend_release(b, p->sock);
+    p->sock = -1;
+}
+
+/* RICHIESTE DEI CLIENT */
+static void handle_front(int front, int64_t now) {
+    uint8_t buffer_req[REQ_BUFFER_SIZE], key[REQ_BUFFER_SIZE], resp[RESP_BUFFER_SIZE];
+
+    for (int n = 0; n < PROXY_RECV_BATCH; n++) {
+        struct sockaddr_storage client_addr;
+        socklen_t client_len = sizeof(client_addr);
+
+        int len = recvfrom(front, (char*)buffer_req, REQ_BUFFER_SIZE, 0, (struct sockaddr*)&client_addr, &client_len);
+        if (len < 0) return;
+        if (len != REQ_BUFFER_SIZE) continue;
+
+        st_requests++;
+        normalize_request(buffer_req, key);
+        uint32_t hash = ring_hash(key, REQ_BUFFER_SIZE);
+
+        /* CACHE */
+        if (cache_get(key, hash, now, resp)) {
+            st_hits++;
+            sendto(front, (const char*)resp, RESP_BUFFER_SIZE, 0, (struct sockaddr*)&client_addr, (int)client_len);
+            continue;
+        }
+
+        /* COALESCENZA: stessa richiesta già inoltrata */
+        pending_t *p = pending_find(key, hash);
+        if (p != NULL) {
+            if (p->n_waiters >= PROXY_MAX_WAITERS) {
+                st_dropped++;
+                continue;
+            }
+            memcpy(&p->waiters[p->n_waiters], &client_addr, client_len);
+            p->waiter_len[p->n_waiters++] = client_len;
+            st_coalesced++;
+            continue;
+        }
+
+        /* INOLTRO */
+        p = pending_alloc();
+        if (p == NULL) {
+            st_dropped++;
+            continue;
+        }
+        memcpy(p->key, key, REQ_BUFFER_SIZE);
+        p->hash = hash;
+        p->city_hash = ring_hash(&key[1], strnlen((const char*)&key[1], CITY_MAX));
+        p->tries = 0;
+        memcpy(&p->waiters[0], &client_addr, client_len);
+        p->waiter_len[0] = client_len;
+        p->n_waiters = 1;
+        if (!pending_send(p, now, -1)) {
+            p->sock = -1;
+            st_dropped++;
+        }
+    }
+}
+
+/* SONDE AI BACKEND MORTI: qualunque risposta lo rimette in gioco */
+static void run_probes(int64_t now) {
+    uint8_t probe[REQ_BUFFER_SIZE];
+    memset(probe, 0, sizeof(probe));
+    probe[0] = TYPE_TEMP;
+    memcpy(&probe[1], PROBE_CITY, sizeof(PROBE_CITY));
+
+    for (int b = 0; b < n_backends; b++) {
+        backend_t *be = &backends[b];
+        if (be->alive || now < be->probe_at_ms) continue;
+
+        if (be->probe_sock >= 0) {
+            /* sonda scaduta senza risposta */
+            closesocket(be->probe_sock);
+            be->probe_sock = -1;
+            be->probe_at_ms = now + BACKEND_PROBE_MS;
+            continue;
+        }
+
+        be->probe_sock = backend_socket(b);
+        if (be->probe_sock >= 0 && send(be->probe_sock, (const char*)probe, REQ_BUFFER_SIZE, 0) != REQ_BUFFER_SIZE) {
+            closesocket(be->probe_sock);
+            be->probe_sock = -1;
+        }
+        be->probe_at_ms = now + (be->probe_sock >= 0 ? BACKEND_TIMEOUT_MS : BACKEND_PROBE_MS);
+    }
+}
+
+static void handle_probe(int b, int64_t now) {
+    backend_t *be = &backends[b];
+    uint8_t resp[RESP_BUFFER_SIZE];
+
+    int len = recv(be->probe_sock, (char*)resp, RESP_BUFFER_SIZE, 0);
+    closesocket(be->probe_sock);
+    be->probe_sock = -1;
+
+    if (len == RESP_BUFFER_SIZE)
+        backend_up(b);
+    else
+        be->probe_at_ms = now + BACKEND_PROBE_MS;
+}
+
+static void print_stats(void) {
+    int alive = 0;
+    for (int b = 0; b < n_backends; b++)
+        alive += backends[b].alive;
+
+    printf("Statistiche [pid %d]: richieste=%llu hit=%llu accorpate=%llu inoltrate=%llu scartate=%llu | backend attivi %d/%d\n",
+           (int)getpid(), st_requests, st_hits, st_coalesced, st_forwarded, st_dropped, alive, n_backends);
+    fflush(stdout);
+}
+
+/*
+ * ============================================================================
+ * SOCKET VERSO I CLIENT E CICLO PRINCIPALE
+ * ============================================================================
+ */
+
+/* Prima socket di res legata con successo, -1 se nessuna */
+static int bind_first(struct addrinfo *res, int reuseport) {
+    for (struct addrinfo *ai = res; ai != NULL; ai = ai->ai_next) {
+        int sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (sock < 0) continue;
+
+        if (ai->ai_family == AF_INET6) {
+            int v6only = 0;
+            setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&v6only, sizeof(v6only));
+        }
+#if defined SO_REUSEPORT
+        if (reuseport) {
+            int on = 1;
+            setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, (const char*)&on, sizeof(on));
+        }
+#else
+        (void)reuseport;
+#endif
+        if (bind(sock, ai->ai_addr, (int)ai->ai_addrlen) == 0)
+            return sock;
+
+        closesocket(sock);
+    }
+    return -1;
+}
+
+static int open_front(int port, int reuseport) {
+    static const int families[] = { AF_INET6, AF_INET };
+    char port_str[16];
+    snprintf(port_str, sizeof(port_str), "%d", port);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_protocol = IPPROTO_UDP;
+    hints.ai_flags = AI_PASSIVE;
+
+    /*
+     * prima IPv6 dual-stack, poi IPv4: getaddrinfo restituisce "::" anche
+     * dove il kernel non ha IPv6, e allora fallisce socket() o bind()
+     */
+    int sock = -1, err = 0;
+    for (size_t f = 0; sock < 0 && f < sizeof(families) / sizeof(families[0]); f++) {
+        struct addrinfo *res = NULL;
+        hints.ai_family = families[f];
+        err = getaddrinfo(NULL, port_str, &hints, &res);
+        if (err != 0) continue;
+        sock = bind_first(res, reuseport);
+        freeaddrinfo(res);
+    }
+
+    if (sock < 0) {
+        if (err != 0)
+            fprintf(stderr, "getaddrinfo() failed: %s\n", gai_strerror(err));
+        else
+            errorhandler("bind() fallita.\n");
+        return -1;
+    }
+    set_nonblocking(sock);
+    return sock;
+}
+
+/*
+ * Impostato da SIGINT/SIGTERM. Un segnale che arriva appena prima di select()
+ * viene visto al più dopo un secondo: l'attesa non supera mai quel limite.
+ */
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_stop_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+/* Ciclo del proxy: 1 se fermato da un segnale, 0 su errore */
+static int proxy_run(int front, int stats_interval) {
+    int64_t next_stats = now_ms() + (int64_t)stats_interval * 1000;
+
+    for (int i = 0; i < PROXY_MAX_PENDING; i++)
+        pending[i].sock = -1;
+
+    while (!stop_requested) {
+        int64_t now = now_ms();
+
+        /* TIMEOUT: richieste senza risposta e sonde */
+        int64_t wake = now + 1000;
+        for (int i = 0; i < PROXY_MAX_PENDING; i++) {
+            pending_t *p = &pending[i];
+            if (p->sock < 0) continue;
+            if (p->deadline_ms <= now) {
+                int b = p->backend;
+                /* la socket può ancora ricevere una risposta tardiva: non si riusa */
+                closesocket(p->sock);
+                backend_failed(b, now, 0);
+                pending_retry(p, now);
+            }
+            if (p->sock >= 0 && p->deadline_ms < wake) wake = p->deadline_ms;
+        }
+        run_probes(now);
+        for (int b = 0; b < n_backends; b++)
+            if (!backends[b].alive && backends[b].probe_at_ms < wake) wake = backends[b].probe_at_ms;
+
+        if (stats_interval > 0) {
+            if (now >= next_stats) {
+                print_stats();
+                next_stats = now + (int64_t)stats_interval * 1000;
+            }
+            if (next_stats < wake) wake = next_stats;
+        }
+
+        /* ATTESA */
+        fd_set rfds;
+        FD_ZERO(&rfds);
+        FD_SET(front, &rfds);
+        int maxfd = front;
+        for (int i = 0; i < PROXY_MAX_PENDING; i++) {
+            if (pending[i].sock < 0) continue;
+            FD_SET(pending[i].sock, &rfds);
+            if (pending[i].sock > maxfd) maxfd = pending[i].sock;
+        }
+        for (int b = 0; b < n_backends; b++) {
+            if (backends[b].probe_sock < 0) continue;
+            FD_SET(backends[b].probe_sock, &rfds);
+            if (backends[b].probe_sock > maxfd) maxfd = backends[b].probe_sock;
+        }
+
+        int64_t wait_ms = wake > now ? wake - now : 0;
+        struct timeval tv;
+        tv.tv_sec = (long)(wait_ms / 1000);
+        tv.tv_usec = (long)(wait_ms % 1000) * 1000;
+
+        int ready = select(maxfd + 1, &rfds, NULL, NULL, &tv);
+        if (ready < 0) {
+#if !defined WIN32
+            if (errno == EINTR) continue;
+#endif
+            errorhandler("select() fallita.\n");
+            return 0;
+        }
+        if (ready == 0) continue;
+
+        now = now_ms();
+        for (int i = 0; i < PROXY_MAX_PENDING; i++)
+            if (pending[i].sock >= 0 && FD_ISSET(pending[i].sock, &rfds))
+                handle_backend(front, &pending[i], now);
+        for (int b = 0; b < n_backends; b++)
+            if (backends[b].probe_sock >= 0 && FD_ISSET(backends[b].probe_sock, &rfds))
+                handle_probe(b, now);
+        /* per ultime: le voci appena liberate servono alle nuove richieste */
+        if (FD_ISSET(front, &rfds))
+            handle_front(front, now);
+    }
+
+    if (stats_interval > 0)
+        print_stats();
+    return 1;
+}
+
+#if !defined WIN32 && defined SO_REUSEPORT
+static pid_t worker_pids[PROXY_MAX_WORKERS];
+static int n_workers = 0;
+
+/* Terminando il processo principale terminano anche i worker */
+static void stop_workers(int sig) {
+    for (int w = 0; w < n_workers; w++)
+        kill(worker_pids[w], SIGTERM);
+    on_stop_signal(sig);
+}
+#endif
+
+int main(int argc, char *argv[]) {
+
+#if defined WIN32
+	// Initialize Winsock
+	WSADATA wsa_data;
+	int result = WSAStartup(MAKEWORD(2,2), &wsa_data);
+	if (result != NO_ERROR) {
+		printf("Error at WSAStartup()\n");
+		return 0;
+	}
+#endif
+
+    proxy_options_t opt;
+    memset(&opt, 0, sizeof(opt));
+    opt.port = SERVER_PORT;
+    opt.ttl_ms = PROXY_CACHE_TTL_MS;
+    opt.workers = 1;
+
+    if (!parse_args(argc, argv, &opt)) {
+        printf("Uso corretto: %s -b host[:porta]... [-p porta] [-t ttl_ms] [-w worker] [-S secondi]\n", argv[0]);
+        clearwinsock();
+        return EXIT_FAILURE;
+    }
+
+    /* BACKEND E ANELLO */
+    for (int i = 0; i < opt.n_backends; i++) {
+        if (!backend_resolve(opt.backends[i], &backends[n_backends])) {
+            clearwinsock();
+            return EXIT_FAILURE;
+        }
+        n_backends++;
+    }
+    rebuild_ring();
+
+    cache_ttl_ms = opt.ttl_ms;
+    if (cache_ttl_ms > 0) {
+        cache = calloc(PROXY_CACHE_SLOTS, sizeof(cache_entry_t));
+        if (cache == NULL) {
+            errorhandler("Memoria insufficiente per la cache.\n");
+            clearwinsock();
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("Proxy meteo UDP in ascolto sulla porta %d, %d backend, cache %s",
+           opt.port, n_backends, cache != NULL ? "attiva" : "disattivata");
+    if (cache != NULL) printf(" (TTL %d ms)", cache_ttl_ms);
+    printf(", %d worker\n", opt.workers);
+    fflush(stdout);
+
+#if defined WIN32 || !defined SO_REUSEPORT
+    if (opt.workers > 1) {
+        fprintf(stderr, "Più worker richiedono SO_REUSEPORT: uso un solo processo.\n");
+        opt.workers = 1;
+    }
+#else
+    /* WORKER: processi indipendenti, il kernel ripartisce i client tra le socket */
+    if (opt.workers > 1) {
+        signal(SIGINT, stop_workers);
+        signal(SIGTERM, stop_workers);
+        for (int w = 0; w < opt.workers; w++) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                perror("fork() failed");
+                break;
+            }
+            if (pid == 0) {
+                signal(SIGINT, on_stop_signal);
+                signal(SIGTERM, on_stop_signal);
+                int front = open_front(opt.port, 1);
+                if (front < 0) _exit(EXIT_FAILURE);
+                int ok = proxy_run(front, opt.stats_interval);
+                closesocket(front);
+                _exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+            }
+            worker_pids[n_workers++] = pid;
+        }
+
+        /* successo solo se tutti i worker si sono fermati su richiesta */
+        int status, failed = n_workers < opt.workers;
+        while (wait(&status) > 0)
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+                failed = 1;
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+#endif
+
+    signal(SIGINT, on_stop_signal);
+    signal(SIGTERM, on_stop_signal);
+
+    int front = open_front(opt.port, 0);
+    if (front < 0) {
+        clearwinsock();
+        return EXIT_FAILURE;
+    }
+
+    int ok = proxy_run(front, opt.stats_interval);
+
+    closesocket(front);
+    clearwinsock();
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
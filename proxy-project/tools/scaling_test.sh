@@ -0,0 +1,87 @@
+#!/bin/sh
+#
+# scaling_test.sh
+#
+# Misura di scalabilità del proxy in locale: carico fisso (CLIENTS client in
+# parallelo, ognuno su una città diversa, REQUESTS richieste ciascuno) e
+# numero di backend crescente. Cache del proxy disattivata (-t 0), così ogni
+# richiesta arriva a un server. Per ogni configurazione stampa il throughput
+# complessivo (somma delle righe "Benchmark" dei client) e l'RTT medio.
+#
+# Da lanciare dalla radice del repository:
+#   sh proxy-project/tools/scaling_test.sh
+#
+# Variabili d'ambiente (con i valori predefiniti):
+#   BACKENDS="1 2 4"   configurazioni di backend da provare
+#   WORKERS=<core>     worker del proxy (-w), al massimo 4
+#   CLIENTS=8          client in parallelo (al massimo 8)
+#   REQUESTS=20000     richieste per client
+#   PORT=56800         porta del proxy; i backend usano le successive
+#
+# Esce con 0 se tutte le misure riescono, 1 altrimenti.
+
+CORES=$(nproc 2>/dev/null || echo 1)
+BACKENDS=${BACKENDS:-"1 2 4"}
+WORKERS=${WORKERS:-$([ "$CORES" -gt 4 ] && echo 4 || echo "$CORES")}
+CLIENTS=${CLIENTS:-8}
+REQUESTS=${REQUESTS:-20000}
+PORT=${PORT:-56800}
+CITIES="bari roma milano napoli torino palermo genova bologna"
+WORK=$(mktemp -d /tmp/proxy_scaling.XXXXXX)
+PIDS=
+
+fail() { echo "FAIL: $*"; exit 1; }
+
+cleanup() {
+    [ -n "$PIDS" ] && kill $PIDS 2>/dev/null && wait $PIDS 2>/dev/null
+    rm -rf "$WORK"
+}
+
+[ -d proxy-project/src ] || fail "lanciare dalla radice del repository"
+
+# ---- COMPILAZIONE ----
+gcc -O2 server-project/src/*.c -o "$WORK/server" -lpthread || fail "compilazione del server"
+gcc -O2 proxy-project/src/*.c -o "$WORK/proxy" || fail "compilazione del proxy"
+gcc -O2 client-project/src/*.c -o "$WORK/client" 2>/dev/null || fail "compilazione del client"
+trap cleanup EXIT INT TERM
+
+echo "Core: $CORES, worker del proxy: $WORKERS, client: $CLIENTS x $REQUESTS richieste"
+printf "%-8s %14s %14s\n" "backend" "richieste/s" "RTT medio us"
+
+for n in $BACKENDS; do
+    PIDS=
+    b=""
+    for i in $(seq 1 "$n"); do
+        "$WORK/server" -p $((PORT + i)) > /dev/null 2>&1 &
+        PIDS="$PIDS $!"
+        b="$b -b localhost:$((PORT + i))"
+    done
+    "$WORK/proxy" -p "$PORT" -t 0 -w "$WORKERS" $b > /dev/null 2>&1 &
+    PIDS="$PIDS $!"
+    sleep 1
+
+    c_pids=""
+    c=0
+    for city in $CITIES; do
+        [ "$c" -ge "$CLIENTS" ] && break
+        "$WORK/client" -p "$PORT" -u -n "$REQUESTS" -r "t $city" > "$WORK/client.$c" 2>&1 &
+        c_pids="$c_pids $!"
+        c=$((c + 1))
+    done
+    wait $c_pids
+
+    # "Benchmark: N richieste via udp, RTT medio X us, minimo Y us, Z richieste/s"
+    cat "$WORK"/client.* | awk -v n="$n" -v c="$c" '
+        /^Benchmark/ { ok++; rate += $(NF - 1); rtt += $8 }
+        END {
+            if (ok != c) exit 1
+            printf "%-8d %14.0f %14.1f\n", n, rate, rtt / ok
+        }' || fail "client senza risultato con $n backend"
+
+    rm -f "$WORK"/client.*
+    kill $PIDS 2>/dev/null
+    wait $PIDS 2>/dev/null
+    PIDS=
+done
+
+exit 0
@@ -0,0 +1,171 @@
+/*
+ * xdp_weather.bpf.c
+ *
+ * Programma XDP caricato dal server (opzione -X).
+ *
+ * Le richieste "semplici" al servizio (Ethernet/IPv4 senza opzioni né
+ * frammentazione, UDP verso la porta del server, payload di REQ_BUFFER_SIZE
+ * byte) vengono cercate in resp_cache, che il server riempie con risposte
+ * già serializzate (opzione -C): in caso di successo la risposta parte dal
+ * driver con XDP_TX. Le altre vengono ridirette al socket AF_XDP della coda
+ * RX su cui arrivano. Tutto il resto prosegue nello stack del kernel
+ * (XDP_PASS) e viene servito dal normale socket UDP, che resta il percorso
+ * di ripiego.
+ *
+ * Compilazione: clang -O2 -g -target bpf -c bpf/xdp_weather.bpf.c -o xdp_weather.bpf.o
+ */
+
+#include <linux/bpf.h>
+#include <linux/if_ether.h>
+#include <linux/ip.h>
+#include <linux/in.h>
+#include <linux/udp.h>
+#include <bpf/bpf_helpers.h>
+#include <bpf/bpf_endian.h>
+#include "../src/xdp_weather.h"
+
+struct {
+    __uint(type, BPF_MAP_TYPE_XSKMAP);
+    __uint(max_entries, XDP_MAX_QUEUES);
+    __type(key, __u32);
+    __type(value, __u32);
+} xsks_map SEC(".maps");
+
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, struct xdp_weather_config);
+} config_map SEC(".maps");
+
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, 1024);
+    __type(key, struct xdp_cache_key);
+    __type(value, struct xdp_cache_value);
+} resp_cache SEC(".maps");
+
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, XDP_STAT_COUNT);
+    __type(key, __u32);
+    __type(value, __u64);
+} stats_map SEC(".maps");
+
+#define ETH_MIN_FRAME 60            // frame Ethernet minimo senza FCS
+
+static __always_inline void count(__u32 idx)
+{
+    __u64 *v = bpf_map_lookup_elem(&stats_map, &idx);
+    if (v)
+        *v += 1;
+}
+
+static __always_inline __u16 ip_checksum(struct iphdr *ip)
+{
+    __u16 *p = (__u16 *)ip;
+    __u32 sum = 0;
+
+    for (int i = 0; i < (int)sizeof(*ip) / 2; i++)
+        sum += p[i];
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return (__u16)~sum;
+}
+
+/* Risposta dalla cache scritta sul posto; XDP_TX se possibile */
+static __always_inline int reply_from_cache(struct xdp_md *ctx, struct ethhdr *eth, struct iphdr *ip,
+                                            struct udphdr *udp, __u8 *payload, void *data_end)
+{
+    struct xdp_cache_key key = {};
+    int ended = 0;
+
+    key.type = payload[0];
+    for (int i = 0; i < XDP_CITY_MAX - 1; i++) {
+        __u8 c = payload[1 + i];
+        if (c == 0)
+            ended = 1;
+        if (ended)
+            c = 0;
+        else if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        key.city[i] = c;
+    }
+
+    struct xdp_cache_value *val = bpf_map_lookup_elem(&resp_cache, &key);
+    if (!val) {
+        count(XDP_STAT_MISS);
+        return -1;
+    }
+    count(XDP_STAT_HIT);
+
+    /* scambio degli indirizzi */
+    __u8 mac[ETH_ALEN];
+    __builtin_memcpy(mac, eth->h_dest, ETH_ALEN);
+    __builtin_memcpy(eth->h_dest, eth->h_source, ETH_ALEN);
+    __builtin_memcpy(eth->h_source, mac, ETH_ALEN);
+
+    __be32 addr = ip->saddr;
+    ip->saddr = ip->daddr;
+    ip->daddr = addr;
+
+    __be16 port = udp->source;
+    udp->source = udp->dest;
+    udp->dest = port;
+
+    /* payload: risposta e zeri fino al frame minimo (niente resti della richiesta) */
+    __builtin_memcpy(payload, val->resp, XDP_RESP_LEN);
+    __builtin_memset(payload + XDP_RESP_LEN, 0, ETH_MIN_FRAME - (sizeof(*eth) + sizeof(*ip) + sizeof(*udp) + XDP_RESP_LEN));
+
+    udp->len = bpf_htons(sizeof(*udp) + XDP_RESP_LEN);
+    udp->check = 0;
+
+    ip->tot_len = bpf_htons(sizeof(*ip) + sizeof(*udp) + XDP_RESP_LEN);
+    ip->ttl = 64;
+    ip->check = 0;
+    ip->check = ip_checksum(ip);
+
+    /* ultima operazione: dopo adjust_tail i puntatori non sono più validi */
+    int delta = ETH_MIN_FRAME - (int)(data_end - (void *)eth);
+    if (delta < 0 && bpf_xdp_adjust_tail(ctx, delta) != 0)
+        return XDP_DROP;
+
+    return XDP_TX;
+}
+
+SEC("xdp")
+int xdp_weather(struct xdp_md *ctx)
+{
+    void *data = (void *)(long)ctx->data;
+    void *data_end = (void *)(long)ctx->data_end;
+    __u32 zero = 0;
+
+    struct xdp_weather_config *cfg = bpf_map_lookup_elem(&config_map, &zero);
+    if (!cfg)
+        return XDP_PASS;
+
+    struct ethhdr *eth = data;
+    if ((void *)(eth + 1) > data_end || eth->h_proto != bpf_htons(ETH_P_IP))
+        return XDP_PASS;
+
+    /* niente opzioni IP né frammenti: il percorso rapido li ignora */
+    struct iphdr *ip = (void *)(eth + 1);
+    if ((void *)(ip + 1) > data_end || ip->ihl != 5 || ip->protocol != IPPROTO_UDP ||
+        (ip->frag_off & bpf_htons(0x3FFF)) != 0)
+        return XDP_PASS;
+
+    struct udphdr *udp = (void *)(ip + 1);
+    if ((void *)(udp + 1) > data_end || udp->dest != cfg->port ||
+        udp->len != bpf_htons(sizeof(*udp) + XDP_REQ_LEN) ||
+        (void *)(udp + 1) + XDP_REQ_LEN > data_end)
+        return XDP_PASS;
+
+    int action = reply_from_cache(ctx, eth, ip, udp, (__u8 *)(udp + 1), data_end);
+    if (action >= 0)
+        return action;
+
+    /* senza socket AF_XDP sulla coda il pacchetto va allo stack */
+    return bpf_redirect_map(&xsks_map, ctx->rx_queue_index, XDP_PASS);
+}
+
+char _license[] SEC("license") = "GPL";
@@ -0,0 +1,366 @@
+/*
+ * afxdp.c
+ *
+ * Socket AF_XDP gestito con le sole interfacce del kernel (linux/if_xdp.h).
+ *
+ * Tutti i frame della UMEM partono nell'anello di riempimento (fill).
+ * Un frame ricevuto viene trasformato in risposta sul posto (indirizzi
+ * Ethernet, IP e porte scambiati, payload di RESP_BUFFER_SIZE byte) e messo
+ * nell'anello TX; quando il kernel lo restituisce nell'anello di
+ * completamento torna nel fill. I frame scartati tornano subito nel fill.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "afxdp.h"
+
+#if defined HAVE_XDP
+
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <arpa/inet.h>
+#include <linux/if_xdp.h>
+#include <linux/if_ether.h>
+#include <linux/ip.h>
+#include <linux/in.h>
+#include <linux/udp.h>
+#include <bpf/bpf.h>
+#include "protocol.h"
+#include "xdp_weather.h"
+#include "xdp_prog.h"
+#include "stats.h"
+
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+#define ETH_MIN_FRAME 60            // frame Ethernet minimo senza FCS
+
+_Static_assert(XDP_REQ_LEN == REQ_BUFFER_SIZE, "XDP_REQ_LEN non allineato a protocol.h");
+_Static_assert(XDP_RESP_LEN == RESP_BUFFER_SIZE, "XDP_RESP_LEN non allineato a protocol.h");
+
+/* Anello condiviso con il kernel: indici produttore/consumatore liberi di avanzare */
+typedef struct {
+    __u32 *producer;
+    __u32 *consumer;
+    __u32 *flags;
+    void *descs;
+    __u32 mask;
+    void *map;
+    size_t map_len;
+} xsk_ring_t;
+
+static int xsk_fd = -1;
+static int xsk_queue = -1;
+static void *umem = NULL;
+static xsk_ring_t fill_ring, comp_ring, rx_ring, tx_ring;
+
+/* ---- ANELLI ---- */
+
+static int ring_map(xsk_ring_t *r, const struct xdp_ring_offset *off, __u32 size, size_t desc_size, off_t pgoff) {
+    r->map_len = off->desc + size * desc_size;
+    r->map = mmap(NULL, r->map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, xsk_fd, pgoff);
+    if (r->map == MAP_FAILED) {
+        r->map = NULL;
+        return 0;
+    }
+
+    r->producer = (__u32*)((char*)r->map + off->producer);
+    r->consumer = (__u32*)((char*)r->map + off->consumer);
+    r->flags = (__u32*)((char*)r->map + off->flags);
+    r->descs = (char*)r->map + off->desc;
+    r->mask = size - 1;
+    return 1;
+}
+
+static void ring_unmap(xsk_ring_t *r) {
+    if (r->map != NULL)
+        munmap(r->map, r->map_len);
+    memset(r, 0, sizeof(*r));
+}
+
+/* Voci pronte da consumare (anelli RX e completamento) */
+static __u32 ring_ready(const xsk_ring_t *r) {
+    return __atomic_load_n(r->producer, __ATOMIC_ACQUIRE) - *r->consumer;
+}
+
+/* Posti liberi per produrre (anelli fill e TX) */
+static __u32 ring_free(const xsk_ring_t *r) {
+    return r->mask + 1 - (*r->producer - __atomic_load_n(r->consumer, __ATOMIC_ACQUIRE));
+}
+
+static void fill_put(__u64 addr) {
+    __u32 prod = *fill_ring.producer;
+    ((__u64*)fill_ring.descs)[prod & fill_ring.mask] = addr;
+    __atomic_store_n(fill_ring.producer, prod + 1, __ATOMIC_RELEASE);
+}
+
+/* Riporta nel fill i frame già trasmessi */
+static void reclaim_completed(void) {
+    __u32 n = ring_ready(&comp_ring);
+    __u32 cons = *comp_ring.consumer;
+
+    for (__u32 i = 0; i < n; i++)
+        fill_put(((__u64*)comp_ring.descs)[(cons + i) & comp_ring.mask]);
+
+    __atomic_store_n(comp_ring.consumer, cons + n, __ATOMIC_RELEASE);
+}
+
+/*
+ * Con XDP_USE_NEED_WAKEUP il kernel, trovato il fill vuoto, smette di
+ * prelevarne frame finché non riceve una syscall: dopo averlo riempito
+ * (prod diverso dal produttore di partenza) lo si sveglia se lo chiede.
+ */
+static void fill_wakeup(__u32 prod) {
+    if (*fill_ring.producer != prod &&
+        (__atomic_load_n(fill_ring.flags, __ATOMIC_ACQUIRE) & XDP_RING_NEED_WAKEUP))
+        recvfrom(xsk_fd, NULL, 0, MSG_DONTWAIT, NULL, NULL);
+}
+
+/* ---- PACCHETTI ---- */
+
+static __u16 ip_checksum(const struct iphdr *ip) {
+    const __u16 *p = (const __u16*)ip;
+    __u32 sum = 0;
+
+    for (int i = 0; i < (int)sizeof(*ip) / 2; i++)
+        sum += p[i];
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    return (__u16)~sum;
+}
+
+/*
+ * Trasforma la richiesta nel frame in una risposta sul posto.
+ * Ritorna la nuova lunghezza del frame, 0 se il frame va scartato.
+ */
+static __u32 build_reply(__u8 *frame, __u32 len) {
+    struct ethhdr *eth = (struct ethhdr*)frame;
+    struct iphdr *ip = (struct iphdr*)(eth + 1);
+    struct udphdr *udp = (struct udphdr*)(ip + 1);
+    __u8 *payload = (__u8*)(udp + 1);
+
+    /* stessi controlli del programma XDP: il kernel non li garantisce a noi */
+    if (len < sizeof(*eth) + sizeof(*ip) + sizeof(*udp) + REQ_BUFFER_SIZE ||
+        eth->h_proto != htons(ETH_P_IP) || ip->ihl != 5 || ip->protocol != IPPROTO_UDP ||
+        ntohs(udp->len) != sizeof(*udp) + REQ_BUFFER_SIZE)
+        return 0;
+
+    weather_request_t req;
+    memset(&req, 0, sizeof(req));
+    deserialize_request(payload, &req);
+
+    weather_response_t resp;
+    process_request(&req, &resp);
+
+    /* scambio degli indirizzi */
+    __u8 mac[ETH_ALEN];
+    memcpy(mac, eth->h_dest, ETH_ALEN);
+    memcpy(eth->h_dest, eth->h_source, ETH_ALEN);
+    memcpy(eth->h_source, mac, ETH_ALEN);
+
+    __be32 addr = ip->saddr;
+    ip->saddr = ip->daddr;
+    ip->daddr = addr;
+
+    __be16 port = udp->source;
+    udp->source = udp->dest;
+    udp->dest = port;
+
+    /* risposta nello stesso frame */
+    serialize_response(&resp, payload);
+
+    udp->len = htons(sizeof(*udp) + RESP_BUFFER_SIZE);
+    udp->check = 0;                 // facoltativo su IPv4
+
+    ip->tot_len = htons(sizeof(*ip) + sizeof(*udp) + RESP_BUFFER_SIZE);
+    ip->ttl = 64;
+    ip->frag_off = htons(0x4000);   // DF
+    ip->check = 0;
+    ip->check = ip_checksum(ip);
+
+    __u32 out_len = sizeof(*eth) + sizeof(*ip) + sizeof(*udp) + RESP_BUFFER_SIZE;
+    if (out_len < ETH_MIN_FRAME) {
+        memset(frame + out_len, 0, ETH_MIN_FRAME - out_len);
+        out_len = ETH_MIN_FRAME;
+    }
+    return out_len;
+}
+
+int afxdp_handle(int fd) {
+    (void)fd;
+
+    __u32 fill_prod = *fill_ring.producer;
+    reclaim_completed();
+
+    __u32 n = ring_ready(&rx_ring);
+    if (n == 0) {
+        fill_wakeup(fill_prod);
+        return 0;
+    }
+    if (n > AFXDP_BATCH)
+        n = AFXDP_BATCH;
+
+    __u32 rx_cons = *rx_ring.consumer;
+    __u32 tx_prod = *tx_ring.producer;
+    __u32 tx_room = ring_free(&tx_ring);
+    __u32 sent = 0;
+
+    for (__u32 i = 0; i < n; i++) {
+        struct xdp_desc *d = &((struct xdp_desc*)rx_ring.descs)[(rx_cons + i) & rx_ring.mask];
+        __u8 *frame = (__u8*)umem + d->addr;
+
+        __u32 out_len = sent < tx_room ? build_reply(frame, d->len) : 0;
+        if (out_len == 0) {
+            /* scartato (o anello TX pieno): il frame torna subito al kernel */
+            fill_put(d->addr);
+            continue;
+        }
+
+        struct xdp_desc *t = &((struct xdp_desc*)tx_ring.descs)[(tx_prod + sent) & tx_ring.mask];
+        t->addr = d->addr;
+        t->len = out_len;
+        t->options = 0;
+        sent++;
+    }
+
+    __atomic_store_n(rx_ring.consumer, rx_cons + n, __ATOMIC_RELEASE);
+
+    if (sent > 0) {
+        __atomic_store_n(tx_ring.producer, tx_prod + sent, __ATOMIC_RELEASE);
+        /* in modalità copia/generica la trasmissione parte solo con una syscall */
+        if (__atomic_load_n(tx_ring.flags, __ATOMIC_ACQUIRE) & XDP_RING_NEED_WAKEUP)
+            sendto(xsk_fd, NULL, 0, MSG_DONTWAIT, NULL, 0);
+        stats_add(STAT_AFXDP, sent);
+        /* in copia la trasmissione è già conclusa: i frame tornano subito nel fill */
+        reclaim_completed();
+    }
+
+    fill_wakeup(fill_prod);
+    return 1;
+}
+
+/* ---- APERTURA ---- */
+
+int afxdp_open(int queue) {
+    int ifindex = xdp_prog_ifindex();
+    int xsks_map = xdp_prog_map_fd("xsks_map");
+    if (ifindex == 0 || xsks_map < 0) {
+        fprintf(stderr, "AF_XDP richiede il programma XDP agganciato\n");
+        return -1;
+    }
+    if (queue < 0 || queue >= XDP_MAX_QUEUES) {
+        fprintf(stderr, "Coda AF_XDP non valida: %d\n", queue);
+        return -1;
+    }
+
+    xsk_fd = socket(AF_XDP, SOCK_RAW, 0);
+    if (xsk_fd < 0) {
+        perror("socket(AF_XDP) failed");
+        return -1;
+    }
+
+    /* UMEM: area dei frame condivisa con il kernel */
+    size_t umem_len = (size_t)AFXDP_NUM_FRAMES * AFXDP_FRAME_SIZE;
+    umem = mmap(NULL, umem_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (umem == MAP_FAILED) {
+        umem = NULL;
+        perror("mmap(UMEM) failed");
+        afxdp_close();
+        return -1;
+    }
+
+    struct xdp_umem_reg mr;
+    memset(&mr, 0, sizeof(mr));
+    mr.addr = (__u64)(unsigned long)umem;
+    mr.len = umem_len;
+    mr.chunk_size = AFXDP_FRAME_SIZE;
+    mr.headroom = 0;
+
+    int fill_size = AFXDP_NUM_FRAMES, ring_size = AFXDP_RING_SIZE;
+    if (setsockopt(xsk_fd, SOL_XDP, XDP_UMEM_REG, &mr, sizeof(mr)) < 0 ||
+        setsockopt(xsk_fd, SOL_XDP, XDP_UMEM_FILL_RING, &fill_size, sizeof(fill_size)) < 0 ||
+        setsockopt(xsk_fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ring_size, sizeof(ring_size)) < 0 ||
+        setsockopt(xsk_fd, SOL_XDP, XDP_RX_RING, &ring_size, sizeof(ring_size)) < 0 ||
+        setsockopt(xsk_fd, SOL_XDP, XDP_TX_RING, &ring_size, sizeof(ring_size)) < 0) {
+        perror("setsockopt(SOL_XDP) failed");
+        afxdp_close();
+        return -1;
+    }
+
+    struct xdp_mmap_offsets off;
+    socklen_t optlen = sizeof(off);
+    if (getsockopt(xsk_fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) < 0 ||
+        !ring_map(&fill_ring, &off.fr, fill_size, sizeof(__u64), XDP_UMEM_PGOFF_FILL_RING) ||
+        !ring_map(&comp_ring, &off.cr, ring_size, sizeof(__u64), XDP_UMEM_PGOFF_COMPLETION_RING) ||
+        !ring_map(&rx_ring, &off.rx, ring_size, sizeof(struct xdp_desc), XDP_PGOFF_RX_RING) ||
+        !ring_map(&tx_ring, &off.tx, ring_size, sizeof(struct xdp_desc), XDP_PGOFF_TX_RING)) {
+        perror("mmap(anelli AF_XDP) failed");
+        afxdp_close();
+        return -1;
+    }
+
+    /* tutti i frame al kernel per la ricezione */
+    for (__u32 i = 0; i < AFXDP_NUM_FRAMES; i++)
+        fill_put((__u64)i * AFXDP_FRAME_SIZE);
+
+    struct sockaddr_xdp sxdp;
+    memset(&sxdp, 0, sizeof(sxdp));
+    sxdp.sxdp_family = AF_XDP;
+    sxdp.sxdp_ifindex = (__u32)ifindex;
+    sxdp.sxdp_queue_id = (__u32)queue;
+    sxdp.sxdp_flags = XDP_USE_NEED_WAKEUP | (xdp_prog_generic() ? XDP_COPY : 0);
+
+    if (bind(xsk_fd, (struct sockaddr*)&sxdp, sizeof(sxdp)) < 0) {
+        perror("bind(AF_XDP) failed");
+        afxdp_close();
+        return -1;
+    }
+
+    __u32 key = (__u32)queue;
+    if (bpf_map_update_elem(xsks_map, &key, &xsk_fd, BPF_ANY) != 0) {
+        fprintf(stderr, "Registrazione in xsks_map fallita: %s\n", strerror(errno));
+        afxdp_close();
+        return -1;
+    }
+    xsk_queue = queue;
+
+    printf("Socket AF_XDP sulla coda %d (%s)\n", queue, xdp_prog_generic() ? "copia" : "nativo");
+    return xsk_fd;
+}
+
+void afxdp_close(void) {
+    if (xsk_queue >= 0) {
+        __u32 key = (__u32)xsk_queue;
+        bpf_map_delete_elem(xdp_prog_map_fd("xsks_map"), &key);
+        xsk_queue = -1;
+    }
+
+    ring_unmap(&fill_ring);
+    ring_unmap(&comp_ring);
+    ring_unmap(&rx_ring);
+    ring_unmap(&tx_ring);
+
+    if (xsk_fd >= 0)
+        close(xsk_fd);
+    xsk_fd = -1;
+
+    if (umem != NULL)
+        munmap(umem, (size_t)AFXDP_NUM_FRAMES * AFXDP_FRAME_SIZE);
+    umem = NULL;
+}
+
+#else
+
+int afxdp_open(int queue) {
+    (void)queue;
+    fprintf(stderr, "Supporto AF_XDP non compilato (serve -DHAVE_XDP e libbpf)\n");
+    return -1;
+}
+int afxdp_handle(int fd) { (void)fd; return 0; }
+void afxdp_close(void) { }
+
+#endif /* HAVE_XDP */
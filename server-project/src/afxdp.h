@@ -0,0 +1,30 @@
+/*
+ * afxdp.h
+ *
+ * Percorso di ricezione/trasmissione AF_XDP: le richieste ridirette dal
+ * programma XDP arrivano in un'area UMEM condivisa con il kernel e la
+ * risposta viene scritta nello stesso frame, senza attraversare lo stack.
+ * Richiede -DHAVE_XDP (vedi xdp_prog.h).
+ */
+
+#ifndef AFXDP_H_
+#define AFXDP_H_
+
+#define AFXDP_NUM_FRAMES  4096
+#define AFXDP_FRAME_SIZE  2048
+#define AFXDP_RING_SIZE   2048      // RX, TX e completamento; il fill ha AFXDP_NUM_FRAMES voci
+#define AFXDP_BATCH       64
+
+/*
+ * Crea il socket AF_XDP sulla coda queue dell'interfaccia su cui è
+ * agganciato il programma XDP e lo registra in xsks_map.
+ * Ritorna il file descriptor da passare al loop degli eventi, o -1.
+ */
+int afxdp_open(int queue);
+
+/* Serve un lotto di richieste: 1 se ne ha servite, 0 se l'anello RX è vuoto */
+int afxdp_handle(int fd);
+
+void afxdp_close(void);
+
+#endif /* AFXDP_H_ */
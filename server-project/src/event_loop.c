@@ -0,0 +1,396 @@
+/*
+ * event_loop.c
+ *
+ * Loop degli eventi con più socket in ascolto.
+ *
+ * Su Linux tutti i socket sono registrati in un'unica istanza epoll;
+ * nella modalità busy-poll il thread resta sulla propria CPU e interroga
+ * epoll senza mai dormire, mentre il kernel fa polling della coda della
+ * scheda di rete (SO_BUSY_POLL), evitando la latenza di risveglio.
+ * Altrove si usa select().
+ */
+
+#if defined __linux__
+#define _GNU_SOURCE   // sched_setaffinity, CPU_SET
+#endif
+
+#if defined WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#define closesocket close
+#endif
+
+#if defined __linux__
+#include <sched.h>
+#include <sys/epoll.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <signal.h>
+#include "event_loop.h"
+
+/* Definite da Linux 5.11, assenti negli header più vecchi */
+#if defined __linux__
+#ifndef SO_BUSY_POLL
+#define SO_BUSY_POLL 46
+#endif
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+#ifndef SO_BUSY_POLL_BUDGET
+#define SO_BUSY_POLL_BUDGET 70
+#endif
+#endif
+
+typedef struct {
+    int sock;
+    listener_handler_t handler;
+    char desc[96];
+} listener_t;
+
+static listener_t listeners[MAX_LISTENERS];
+static int n_listeners = 0;
+
+/* ---- APERTURA SOCKET ---- */
+
+/* Separa "[indirizzo][:porta][@interfaccia]" nelle sue parti */
+static int parse_spec(const char *spec, char *host, size_t host_len, char *port, size_t port_len, char *ifname, size_t if_len) {
+    char buf[128];
+    snprintf(buf, sizeof(buf), "%s", spec);
+
+    ifname[0] = '\0';
+    char *at = strchr(buf, '@');
+    if (at != NULL) {
+        *at = '\0';
+        snprintf(ifname, if_len, "%s", at + 1);
+    }
+
+    char *h = buf;
+    char *p = NULL;
+
+    if (h[0] == '[') {
+        /* IPv6 tra parentesi quadre */
+        char *close = strchr(h, ']');
+        if (close == NULL) return 0;
+        *close = '\0';
+        h++;
+        if (close[1] == ':') p = close + 2;
+        else if (close[1] != '\0') return 0;
+    } else {
+        char *colon = strrchr(h, ':');
+        /* un solo ':' separa la porta; più di uno è un IPv6 senza porta */
+        if (colon != NULL && strchr(h, ':') == colon) {
+            *colon = '\0';
+            p = colon + 1;
+        }
+    }
+
+    if (strcmp(h, "*") == 0) h[0] = '\0';
+    snprintf(host, host_len, "%s", h);
+    snprintf(port, port_len, "%s", p != NULL ? p : "");
+    return 1;
+}
+
+/* Primo indirizzo di res su cui riescono socket() e bind(); -1 se nessuno */
+static int bind_first(struct addrinfo *res, int wildcard, const char *ifname, int p, char *desc, size_t desc_len) {
+    int sock = -1;
+
+    for (struct addrinfo *ai = res; ai != NULL; ai = ai->ai_next) {
+        sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (sock < 0) continue;
+
+        if (ai->ai_family == AF_INET6) {
+            /* dual-stack solo per l'indirizzo jolly */
+            int v6only = !wildcard;
+            setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&v6only, sizeof(v6only));
+        }
+
+        if (ifname[0] != '\0') {
+#if defined __linux__
+            if (setsockopt(sock, SOL_SOCKET, SO_BINDTODEVICE, ifname, (socklen_t)strlen(ifname)) < 0) {
+                perror("setsockopt(SO_BINDTODEVICE) failed");
+                closesocket(sock);
+                sock = -1;
+                break;
+            }
+#else
+            fprintf(stderr, "Ascolto per interfaccia disponibile solo su Linux\n");
+            closesocket(sock);
+            sock = -1;
+            break;
+#endif
+        }
+
+        if (bind(sock, ai->ai_addr, (int)ai->ai_addrlen) == 0) {
+            char addr_str[NI_MAXHOST];
+            if (getnameinfo(ai->ai_addr, (int)ai->ai_addrlen, addr_str, sizeof(addr_str), NULL, 0, NI_NUMERICHOST) != 0)
+                snprintf(addr_str, sizeof(addr_str), "?");
+            snprintf(desc, desc_len, "udp %s%s%s port %d%s%s",
+                     ai->ai_family == AF_INET6 ? "[" : "", addr_str, ai->ai_family == AF_INET6 ? "]" : "", p,
+                     ifname[0] ? " dev " : "", ifname);
+            break;
+        }
+
+        closesocket(sock);
+        sock = -1;
+    }
+    return sock;
+}
+
+int listener_open_udp(const char *spec, int default_port, char *desc, size_t desc_len) {
+    char host[128], port[16], ifname[32];
+
+    if (!parse_spec(spec, host, sizeof(host), port, sizeof(port), ifname, sizeof(ifname))) {
+        fprintf(stderr, "Specifica di ascolto non valida: %s\n", spec);
+        return -1;
+    }
+    if (port[0] == '\0')
+        snprintf(port, sizeof(port), "%d", default_port);
+
+    int p = atoi(port);
+    if (p <= 0 || p > 65535) {
+        printf("La porta deve essere compresa tra 0 e 65535\n");
+        return -1;
+    }
+
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_protocol = IPPROTO_UDP;
+    hints.ai_flags = AI_PASSIVE;
+    /* senza indirizzo: prima IPv6 dual-stack, poi IPv4 */
+    hints.ai_family = host[0] == '\0' ? AF_INET6 : AF_UNSPEC;
+
+    int sock = -1;
+    int err = getaddrinfo(host[0] ? host : NULL, port, &hints, &res);
+    if (err == 0) {
+        sock = bind_first(res, host[0] == '\0', ifname, p, desc, desc_len);
+        freeaddrinfo(res);
+    }
+
+    /*
+     * Con IPv6 disattivato nel kernel getaddrinfo riesce ma socket(AF_INET6)
+     * fallisce: il ripiego su IPv4 vale per qualunque errore.
+     */
+    if (sock < 0 && host[0] == '\0') {
+        hints.ai_family = AF_INET;
+        err = getaddrinfo(NULL, port, &hints, &res);
+        if (err == 0) {
+            sock = bind_first(res, 1, ifname, p, desc, desc_len);
+            freeaddrinfo(res);
+        }
+    }
+
+    if (err != 0) {
+        fprintf(stderr, "getaddrinfo(%s) failed: %s\n", spec, gai_strerror(err));
+        return -1;
+    }
+
+    if (sock < 0)
+        fprintf(stderr, "bind() failed per %s\n", spec);
+    return sock;
+}
+
+/* ---- REGISTRAZIONE ---- */
+
+static void set_nonblocking(int sock) {
+#if defined WIN32
+    u_long on = 1;
+    ioctlsocket(sock, FIONBIO, &on);
+#else
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+int listener_add(int sock, listener_handler_t handler, const char *desc) {
+    if (n_listeners >= MAX_LISTENERS) {
+        fprintf(stderr, "Troppi socket in ascolto (massimo %d)\n", MAX_LISTENERS);
+        return 0;
+    }
+
+    /* gli handler svuotano il socket finché non ritorna EAGAIN */
+    set_nonblocking(sock);
+
+    listeners[n_listeners].sock = sock;
+    listeners[n_listeners].handler = handler;
+    snprintf(listeners[n_listeners].desc, sizeof(listeners[n_listeners].desc), "%s", desc);
+    n_listeners++;
+
+    printf("In ascolto: %s\n", desc);
+    return 1;
+}
+
+/* Serve tutti i datagrammi pronti su un listener */
+static int drain(const listener_t *l) {
+    int r;
+    while ((r = l->handler(l->sock)) > 0)
+        ;
+    return r;
+}
+
+/* impostato dal gestore dei segnali: il loop termina al prossimo giro */
+static volatile sig_atomic_t stop_requested = 0;
+
+void event_loop_stop(void) {
+    stop_requested = 1;
+}
+
+#if !defined WIN32
+/*
+ * Maschera per l'attesa: quella del thread senza SIGINT/SIGTERM. Il thread
+ * del loop tiene i due segnali bloccati e li sblocca solo dentro
+ * epoll_pwait()/pselect(), in modo atomico: un segnale arrivato tra il
+ * controllo di stop_requested e l'attesa resta pendente e la interrompe
+ * subito, invece di aspettare il prossimo pacchetto.
+ */
+static void wait_mask(sigset_t *mask) {
+    pthread_sigmask(SIG_SETMASK, NULL, mask);
+    sigdelset(mask, SIGINT);
+    sigdelset(mask, SIGTERM);
+}
+#endif
+
+void event_loop_close(void) {
+    for (int i = 0; i < n_listeners; i++)
+        closesocket(listeners[i].sock);
+    n_listeners = 0;
+}
+
+/* ---- LOOP ---- */
+
+#if defined __linux__
+
+static void enable_busy_poll(int busy_cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(busy_cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0)
+        perror("sched_setaffinity() failed");
+
+    int usec = BUSY_POLL_USEC, on = 1, budget = 64;
+    for (int i = 0; i < n_listeners; i++) {
+        struct sockaddr_storage ss;
+        socklen_t len = sizeof(ss);
+        if (getsockname(listeners[i].sock, (struct sockaddr*)&ss, &len) < 0 ||
+            (ss.ss_family != AF_INET && ss.ss_family != AF_INET6))
+            continue;
+
+        /* SO_BUSY_POLL oltre il valore di sistema richiede CAP_NET_ADMIN */
+        if (setsockopt(listeners[i].sock, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) < 0)
+            perror("setsockopt(SO_BUSY_POLL) failed");
+        if (setsockopt(listeners[i].sock, SOL_SOCKET, SO_PREFER_BUSY_POLL, &on, sizeof(on)) < 0)
+            perror("setsockopt(SO_PREFER_BUSY_POLL) failed");
+        setsockopt(listeners[i].sock, SOL_SOCKET, SO_BUSY_POLL_BUDGET, &budget, sizeof(budget));
+    }
+
+    printf("Modalita' busy-poll sulla CPU %d\n", busy_cpu);
+}
+
+int event_loop_run(int busy_cpu) {
+    int epfd = epoll_create1(0);
+    if (epfd < 0) {
+        perror("epoll_create1() failed");
+        return -1;
+    }
+
+    for (int i = 0; i < n_listeners; i++) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u32 = (uint32_t)i;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, listeners[i].sock, &ev) < 0) {
+            perror("epoll_ctl() failed");
+            close(epfd);
+            return -1;
+        }
+    }
+
+    if (busy_cpu >= 0)
+        enable_busy_poll(busy_cpu);
+
+    /* in busy-poll epoll_pwait non dorme mai */
+    int timeout = busy_cpu >= 0 ? 0 : -1;
+    struct epoll_event events[MAX_LISTENERS];
+    sigset_t mask;
+    wait_mask(&mask);
+
+    while (!stop_requested) {
+        int n = epoll_pwait(epfd, events, MAX_LISTENERS, timeout, &mask);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait() failed");
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            if (drain(&listeners[events[i].data.u32]) < 0) {
+                close(epfd);
+                return -1;
+            }
+        }
+    }
+
+    close(epfd);
+    return stop_requested ? 0 : -1;
+}
+
+#else
+
+int event_loop_run(int busy_cpu) {
+    if (busy_cpu >= 0)
+        fprintf(stderr, "Modalita' busy-poll disponibile solo su Linux, uso select()\n");
+
+#if !defined WIN32
+    sigset_t mask;
+    wait_mask(&mask);
+#endif
+
+    while (!stop_requested) {
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        int maxfd = 0;
+        for (int i = 0; i < n_listeners; i++) {
+            FD_SET(listeners[i].sock, &readfds);
+            if (listeners[i].sock > maxfd) maxfd = listeners[i].sock;
+        }
+
+#if defined WIN32
+        /* su Windows il segnale non interrompe select(): si ricontrolla ogni secondo */
+        struct timeval tv = { 1, 0 };
+        int ready = select(maxfd + 1, &readfds, NULL, NULL, &tv);
+        if (ready < 0) {
+            if (WSAGetLastError() == WSAEINTR) continue;
+            fprintf(stderr, "select() failed\n");
+            return -1;
+        }
+#else
+        int ready = pselect(maxfd + 1, &readfds, NULL, NULL, NULL, &mask);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            perror("pselect() failed");
+            return -1;
+        }
+#endif
+
+        for (int i = 0; ready > 0 && i < n_listeners; i++) {
+            if (FD_ISSET(listeners[i].sock, &readfds) && drain(&listeners[i]) < 0)
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
+#endif /* __linux__ */
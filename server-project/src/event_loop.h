@@ -0,0 +1,47 @@
+/*
+ * event_loop.h
+ *
+ * Loop degli eventi del server: gestisce un numero qualsiasi di socket
+ * in ascolto (IPv4, IPv6, per interfaccia, per porta) da un'unica istanza
+ * epoll (select() sulle piattaforme senza epoll).
+ */
+
+#ifndef EVENT_LOOP_H_
+#define EVENT_LOOP_H_
+
+#define MAX_LISTENERS 16
+#define BUSY_POLL_USEC 50         // budget SO_BUSY_POLL per socket
+
+/* Handler di un socket pronto: 1 datagramma servito, 0 niente da leggere, -1 errore fatale */
+typedef int (*listener_handler_t)(int sock);
+
+/*
+ * Apre un socket UDP secondo la specifica "[indirizzo][:porta][@interfaccia]":
+ *   ""  o "*"        tutte le interfacce, dual-stack IPv6/IPv4
+ *   "0.0.0.0:5000"   solo IPv4
+ *   "[::1]:5000"     IPv6 (le parentesi servono se c'è la porta)
+ *   "*:5000@eth0"    solo l'interfaccia eth0 (SO_BINDTODEVICE, Linux)
+ * Se la porta manca si usa default_port. Ritorna il socket o -1.
+ */
+int listener_open_udp(const char *spec, int default_port, char *desc, size_t desc_len);
+
+/* Registra un socket già aperto nel loop */
+int listener_add(int sock, listener_handler_t handler, const char *desc);
+
+/*
+ * Esegue il loop finché un handler non ritorna -1 o l'attesa fallisce
+ * (risultato -1), o non viene chiamata event_loop_stop() (risultato 0).
+ * Il chiamante tiene SIGINT/SIGTERM bloccati: il loop li riceve solo
+ * durante l'attesa (epoll_pwait/pselect), senza finestre di corsa.
+ * busy_cpu >= 0 abilita la modalità busy-poll: thread fissato sulla CPU,
+ * SO_BUSY_POLL/SO_PREFER_BUSY_POLL sui socket UDP e epoll_wait senza attesa.
+ */
+int event_loop_run(int busy_cpu);
+
+/* Chiede la terminazione del loop; sicura dentro un gestore di segnale */
+void event_loop_stop(void);
+
+/* Chiude tutti i socket registrati */
+void event_loop_close(void);
+
+#endif /* EVENT_LOOP_H_ */
@@ -0,0 +1,337 @@
+/*
+ * fastpath.c
+ *
+ * Fast path per client sullo stesso host.
+ *
+ * - Socket AF_UNIX SOCK_DGRAM: stesso scambio di datagrammi di UDP,
+ *   ma senza attraversare lo stack IP.
+ * - Ring in memoria condivisa (solo Linux): i client depositano la
+ *   richiesta serializzata in uno slot e attendono la risposta sul futex
+ *   dello slot; il server dorme sul futex "doorbell" quando non c'è lavoro.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "protocol.h"
+#include "fastpath.h"
+#include "stats.h"
+
+#if defined WIN32
+
+void fastpath_set_quiet(int quiet) { (void)quiet; }
+int fastpath_unix_open(int port) { (void)port; return -1; }
+int fastpath_unix_handle(int sock) { (void)sock; return 0; }
+void fastpath_unix_close(int port, int sock) { (void)port; (void)sock; }
+int fastpath_shm_start(int port) { (void)port; return 0; }
+void fastpath_shm_stop(void) { }
+
+#else
+
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+
+static int quiet_log = 0;
+
+void fastpath_set_quiet(int quiet) {
+    quiet_log = quiet;
+}
+
+/* ---- SOCKET AF_UNIX ---- */
+
+int fastpath_unix_open(int port) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), UNIX_SOCKET_FMT, port);
+
+    int sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        perror("socket(AF_UNIX) failed");
+        return -1;
+    }
+
+    /*
+     * eventuale file rimasto da un'esecuzione precedente; in /tmp (sticky)
+     * il file di un altro utente non si può rimuovere e il bind fallisce
+     */
+    if (unlink(addr.sun_path) < 0 && errno != ENOENT)
+        fprintf(stderr, "%s appartiene a un altro utente: endpoint locale disattivato\n", addr.sun_path);
+
+    /* solo l'utente del server: nessun altro può scrivere richieste o sostituire il file */
+    mode_t old_mask = umask(077);
+    int bound = bind(sock, (struct sockaddr*)&addr, sizeof(addr));
+    umask(old_mask);
+    if (bound < 0) {
+        perror("bind(AF_UNIX) failed");
+        close(sock);
+        return -1;
+    }
+
+    printf("Endpoint locale AF_UNIX su %s\n", addr.sun_path);
+    return sock;
+}
+
+int fastpath_unix_handle(int sock) {
+    struct sockaddr_un client_addr;
+    socklen_t client_len = sizeof(client_addr);
+    uint8_t buffer_req[REQ_BUFFER_SIZE];
+
+    int recvMsgSize = recvfrom(sock, buffer_req, REQ_BUFFER_SIZE, 0, (struct sockaddr*)&client_addr, &client_len);
+    if (recvMsgSize < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            perror("recvfrom(AF_UNIX) failed");
+        return 0;
+    }
+
+    if (recvMsgSize != REQ_BUFFER_SIZE) {
+        fprintf(stderr, "Richiesta locale di dimensione non valida (%d byte)\n", recvMsgSize);
+        return 1;
+    }
+
+    /* un client non collegato non può ricevere la risposta */
+    if (client_len <= sizeof(sa_family_t)) {
+        fprintf(stderr, "Richiesta locale da socket senza indirizzo, ignorata\n");
+        return 1;
+    }
+
+    weather_request_t req;
+    memset(&req, 0, sizeof(req));
+    deserialize_request(buffer_req, &req);
+
+    if (!quiet_log)
+        printf("Richiesta ricevuta da client locale (unix): type='%c', city='%s'\n", req.type, req.city);
+
+    weather_response_t resp;
+    process_request(&req, &resp);
+
+    uint8_t buffer_resp[RESP_BUFFER_SIZE];
+    serialize_response(&resp, buffer_resp);
+
+    if (sendto(sock, buffer_resp, RESP_BUFFER_SIZE, 0, (struct sockaddr*)&client_addr, client_len) != RESP_BUFFER_SIZE)
+        perror("sendto(AF_UNIX) failed");
+    else
+        stats_add(STAT_UNIX, 1);
+
+    return 1;
+}
+
+void fastpath_unix_close(int port, int sock) {
+    char path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+
+    if (sock >= 0)
+        close(sock);
+    snprintf(path, sizeof(path), UNIX_SOCKET_FMT, port);
+    unlink(path);
+}
+
+/* ---- RING IN MEMORIA CONDIVISA ---- */
+
+#if defined __linux__
+
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+static shm_ring_t *ring = NULL;
+static char ring_name[64];
+static pthread_t ring_tid;
+static int ring_stop = 0;                  // letto dal thread del ring
+
+/* Attesa sul futex al massimo timeout_ms (per il recupero periodico degli slot) */
+static void futex_wait(uint32_t *addr, uint32_t val, int timeout_ms) {
+    struct timespec ts = { timeout_ms / 1000, (timeout_ms % 1000) * 1000000L };
+    syscall(SYS_futex, addr, FUTEX_WAIT, val, &ts, NULL, 0);
+}
+
+static void futex_wake(uint32_t *addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+/* Serve tutti gli slot con una richiesta pronta; ritorna quanti ne ha serviti */
+static int serve_ring(void) {
+    int served = 0;
+
+    for (int i = 0; i < SHM_RING_SLOTS; i++) {
+        shm_slot_t *slot = &ring->slots[i];
+        uint32_t expected = SLOT_REQUEST;
+
+        /* se il client ha già rinunciato (timeout) la CAS fallisce */
+        if (!__atomic_compare_exchange_n(&slot->state, &expected, SLOT_SERVING, 0,
+                                         __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            continue;
+
+        weather_request_t req;
+        memset(&req, 0, sizeof(req));
+        deserialize_request(slot->req, &req);
+
+        if (!quiet_log)
+            printf("Richiesta ricevuta da client locale (shm): type='%c', city='%s'\n", req.type, req.city);
+
+        weather_response_t resp;
+        process_request(&req, &resp);
+        serialize_response(&resp, slot->resp);
+
+        __atomic_store_n(&slot->state, SLOT_RESPONSE, __ATOMIC_RELEASE);
+        futex_wake(&slot->state);
+        stats_add(STAT_SHM, 1);
+        served++;
+    }
+
+    return served;
+}
+
+static uint32_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/*
+ * Recupera gli slot di client terminati senza liberarli. Uno slot torna
+ * libero solo se il proprietario non esiste più e lo ha preso da oltre
+ * 2 * SHM_TIMEOUT_MS (un client vivo non lo tiene così a lungo): la doppia
+ * condizione protegge da pid riusati o di un altro namespace. SLOT_SERVING
+ * appartiene al server e non si tocca.
+ */
+static void reap_slots(uint32_t now) {
+    int reaped = 0;
+
+    for (int i = 0; i < SHM_RING_SLOTS; i++) {
+        shm_slot_t *slot = &ring->slots[i];
+        uint32_t state = __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE);
+        if (state != SLOT_CLAIMED && state != SLOT_REQUEST && state != SLOT_RESPONSE)
+            continue;
+
+        uint32_t owner = __atomic_load_n(&slot->owner_pid, __ATOMIC_ACQUIRE);
+        uint32_t age = now - __atomic_load_n(&slot->claimed_ms, __ATOMIC_RELAXED);
+        if (owner == 0 || age < 2 * SHM_TIMEOUT_MS)
+            continue;
+        if (kill((pid_t)owner, 0) == 0 || errno != ESRCH)
+            continue;
+
+        __atomic_store_n(&slot->owner_pid, 0, __ATOMIC_RELAXED);
+        if (__atomic_compare_exchange_n(&slot->state, &state, SLOT_FREE, 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            reaped++;
+        else
+            __atomic_store_n(&slot->owner_pid, owner, __ATOMIC_RELAXED);   // preso dal server nel frattempo
+    }
+
+    if (reaped > 0)
+        printf("Ring: recuperati %d slot di client terminati\n", reaped);
+}
+
+static void *ring_thread(void *arg) {
+    uint32_t last_reap = monotonic_ms();
+    (void)arg;
+
+    while (!__atomic_load_n(&ring_stop, __ATOMIC_ACQUIRE)) {
+        uint32_t seen = __atomic_load_n(&ring->doorbell, __ATOMIC_ACQUIRE);
+        int served = serve_ring();
+
+        uint32_t now = monotonic_ms();
+        if (now - last_reap >= SHM_REAP_MS) {
+            reap_slots(now);
+            last_reap = now;
+        }
+
+        if (served > 0)
+            continue;
+
+        /* nessun lavoro: dormi finché un client non suona il doorbell */
+        __atomic_store_n(&ring->server_waiting, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&ring->doorbell, __ATOMIC_SEQ_CST) == seen && !__atomic_load_n(&ring_stop, __ATOMIC_ACQUIRE))
+            futex_wait(&ring->doorbell, seen, SHM_REAP_MS);
+        __atomic_store_n(&ring->server_waiting, 0, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+int fastpath_shm_start(int port) {
+    char *name = ring_name;
+    snprintf(ring_name, sizeof(ring_name), SHM_RING_FMT, port);
+
+    /* ring rimasto da un server precedente: i client lo vedrebbero come valido */
+    if (shm_unlink(name) < 0 && errno != ENOENT)
+        fprintf(stderr, "/dev/shm%s appartiene a un altro utente: ring disattivato\n", name);
+
+    /* solo l'utente del server: un ring scrivibile da altri permette risposte false */
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        perror("shm_open() failed");
+        return 0;
+    }
+
+    if (ftruncate(fd, sizeof(shm_ring_t)) < 0) {
+        perror("ftruncate() failed");
+        close(fd);
+        shm_unlink(name);
+        return 0;
+    }
+
+    void *mem = mmap(NULL, sizeof(shm_ring_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        perror("mmap() failed");
+        shm_unlink(name);
+        return 0;
+    }
+
+    ring = (shm_ring_t*)mem;
+    memset(ring, 0, sizeof(*ring));
+    ring->server_pid = (uint32_t)getpid();
+
+    __atomic_store_n(&ring_stop, 0, __ATOMIC_RELAXED);
+    if (pthread_create(&ring_tid, NULL, ring_thread, NULL) != 0) {
+        fprintf(stderr, "pthread_create() failed\n");
+        munmap(mem, sizeof(shm_ring_t));
+        ring = NULL;
+        shm_unlink(name);
+        return 0;
+    }
+
+    /* il magic va pubblicato per ultimo: da qui i client possono usare il ring */
+    __atomic_store_n(&ring->magic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+
+    printf("Ring in memoria condivisa attivo su /dev/shm%s\n", name);
+    return 1;
+}
+
+void fastpath_shm_stop(void) {
+    if (ring == NULL) return;
+
+    /* i client smettono di usare il ring; quelli in attesa vanno in timeout */
+    __atomic_store_n(&ring->magic, 0, __ATOMIC_RELEASE);
+
+    __atomic_store_n(&ring_stop, 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&ring->doorbell, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&ring->doorbell);
+    pthread_join(ring_tid, NULL);
+
+    munmap(ring, sizeof(shm_ring_t));
+    ring = NULL;
+    shm_unlink(ring_name);
+}
+
+#else
+
+int fastpath_shm_start(int port) {
+    (void)port;
+    fprintf(stderr, "Ring in memoria condivisa disponibile solo su Linux\n");
+    return 0;
+}
+
+void fastpath_shm_stop(void) { }
+
+#endif /* __linux__ */
+
+#endif /* WIN32 */
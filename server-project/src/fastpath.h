@@ -0,0 +1,33 @@
+/*
+ * fastpath.h
+ *
+ * Fast path per client sullo stesso host:
+ * endpoint AF_UNIX SOCK_DGRAM e ring in memoria condivisa con futex.
+ */
+
+#ifndef FASTPATH_H_
+#define FASTPATH_H_
+
+/* Con quiet != 0 nessun log per richiesta (modalità busy-poll) */
+void fastpath_set_quiet(int quiet);
+
+/*
+ * Apre e collega il socket AF_UNIX del server; -1 se non disponibile.
+ * Socket e ring sono accessibili solo all'utente del server (0600): i client
+ * li usano solo se appartengono al proprio utente o a root.
+ */
+int fastpath_unix_open(int port);
+
+/* Serve un datagramma dal socket AF_UNIX: 1 servito, 0 socket vuoto */
+int fastpath_unix_handle(int sock);
+
+/* Chiude il socket AF_UNIX (se >= 0) e rimuove il file associato */
+void fastpath_unix_close(int port, int sock);
+
+/* Crea il ring in memoria condivisa e avvia il thread che lo serve (solo Linux) */
+int fastpath_shm_start(int port);
+
+/* Ferma il thread del ring e rimuove il segmento di memoria condivisa */
+void fastpath_shm_stop(void);
+
+#endif /* FASTPATH_H_ */
@@ -8,7 +8,8 @@
  */
 
 #if defined WIN32
-#include <winsock.h>
+#include <winsock2.h>
+#include <ws2tcpip.h>
 #else
 #include <string.h>
 #include <unistd.h>
@@ -17,6 +18,7 @@
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <netdb.h>
+#include <errno.h>
 #define closesocket close
 #endif
 
@@ -25,10 +27,21 @@
 #include <ctype.h>
 #include <time.h>
 #include <string.h>
+#include <signal.h>
 #include "protocol.h"
+#include "fastpath.h"
+#include "event_loop.h"
+#include "tsstore.h"
+#include "xdp_prog.h"
+#include "afxdp.h"
+#include "xdp_cache.h"
+#include "stats.h"
 
 #define NO_ERROR 0
 
+/* In modalità busy-poll nessun log per richiesta (né printf né reverse DNS) */
+static int quiet_log = 0;
+
 void clearwinsock() {
 #if defined WIN32
 	WSACleanup();
@@ -39,6 +52,45 @@ void errorhandler(const char *errorMessage) {
     fprintf(stderr, "%s", errorMessage);
 }
 
+/*
+ * Ctrl-C o kill: il loop termina e main esegue la chiusura ordinata
+ * (sgancio del programma XDP, rimozione degli endpoint locali, statistiche).
+ */
+static void on_stop_signal(int sig) {
+    (void)sig;
+    event_loop_stop();
+}
+
+static void install_signal_handlers(void) {
+#if defined WIN32
+    signal(SIGINT, on_stop_signal);
+    signal(SIGTERM, on_stop_signal);
+#else
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_stop_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+#endif
+}
+
+/*
+ * SIGINT/SIGTERM restano bloccati per tutto il processo: i thread di servizio
+ * (ring, responder XDP, statistiche) nascono con la maschera ereditata e il
+ * thread principale li riceve solo dentro l'attesa del loop (vedi
+ * event_loop_run).
+ */
+static void block_stop_signals(void) {
+#if !defined WIN32
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+#endif
+}
+
 // ---- funzioni per simulare dati meteo ----
 static float frand(float a, float b) {
     return a + ((float) rand() / RAND_MAX) * (b - a);
@@ -54,11 +106,11 @@ float get_pressure()
 { return frand(950.0f,1050.0f); }
 
 /* Lista città supportate*/
-int is_valid_city(const char* c) {
-    const char* list[] = {
-        "bari","roma","milano","napoli","torino",
-        "palermo","genova","bologna","firenze","venezia"};
+const char *city_list[CITY_COUNT] = {
+    "bari","roma","milano","napoli","torino",
+    "palermo","genova","bologna","firenze","venezia"};
 
+int is_valid_city(const char* c) {
     char lower[CITY_MAX];
     strncpy(lower, c, CITY_MAX);
     lower[CITY_MAX - 1] = '\0';
@@ -66,8 +118,8 @@ int is_valid_city(const char* c) {
     for (char* p = lower; *p; p++)
             *p = tolower(*p);
 
-    for (int i = 0; i < 10; i++) {
-        if (strcmp(lower, list[i]) == 0)
+    for (int i = 0; i < CITY_COUNT; i++) {
+        if (strcmp(lower, city_list[i]) == 0)
             return 1; // città trovata valida
     }
 
@@ -89,25 +141,119 @@ int valid_type(char t) {
 }
 
 
-/* parsing porta da linea di comando */
-int parse_port(int argc, char *argv[], int *port) {
-
-    if (argc == 1) return 1;  /* uso porta di default */
-
-    if (argc != 3) return 0;
-
-    if (strcmp(argv[1], "-p") != 0) return 0;
+/* Opzioni del server da linea di comando */
+typedef struct {
+    int port;
+    int use_shm;                          // -m
+    const char *specs[MAX_LISTENERS];     // -l (ripetibile)
+    int n_specs;
+    int busy_cpu;                         // -B, -1 = disattivata
+    const char *data_file;                // -d, NULL = generatori casuali
+    const char *replay_start;             // -R, NULL = tempo reale
+    char xdp_ifname[32];                  // -X interfaccia[:coda], "" = disattivato
+    int xdp_queue;
+    int xdp_generic;                      // -G
+    const char *xdp_obj;                  // -O
+    int xdp_cache_ms;                     // -C, 0 = responder XDP disattivato
+    int stats_interval;                   // -S, 0 = nessuna stampa periodica
+} server_options_t;
+
+/* parsing opzioni da linea di comando */
+int parse_args(int argc, char *argv[], server_options_t *opt) {
+
+    for (int i = 1; i < argc; i++) {
+
+        /* -m: abilita il ring in memoria condivisa */
+        if (strcmp(argv[i], "-m") == 0) {
+            opt->use_shm = 1;
+            continue;
+        }
+
+        /* -G: programma XDP in modalità generica (veth, schede senza XDP nativo) */
+        if (strcmp(argv[i], "-G") == 0) {
+            opt->xdp_generic = 1;
+            continue;
+        }
+
+        if (i + 1 >= argc) return 0;
+
+        /* -l [indirizzo][:porta][@interfaccia]: socket in ascolto aggiuntivo */
+        if (strcmp(argv[i], "-l") == 0) {
+            if (opt->n_specs >= MAX_LISTENERS) return 0;
+            opt->specs[opt->n_specs++] = argv[++i];
+            continue;
+        }
+
+        if (argv[i + 1][0] == '-') return 0;
+
+        /* -B cpu: modalità busy-poll fissata sulla CPU indicata */
+        if (strcmp(argv[i], "-B") == 0) {
+            if (!isdigit((unsigned char)argv[i + 1][0])) return 0;
+            opt->busy_cpu = atoi(argv[++i]);
+            continue;
+        }
+
+        /* -d file: serie storiche al posto dei generatori casuali */
+        if (strcmp(argv[i], "-d") == 0) {
+            opt->data_file = argv[++i];
+            continue;
+        }
+
+        /* -R epoch: orologio di replay per le serie storiche */
+        if (strcmp(argv[i], "-R") == 0) {
+            if (!isdigit((unsigned char)argv[i + 1][0])) return 0;
+            opt->replay_start = argv[++i];
+            continue;
+        }
+
+        /* -X interfaccia[:coda]: percorso AF_XDP sulla coda RX indicata */
+        if (strcmp(argv[i], "-X") == 0) {
+            snprintf(opt->xdp_ifname, sizeof(opt->xdp_ifname), "%s", argv[++i]);
+            char *colon = strchr(opt->xdp_ifname, ':');
+            if (colon != NULL) {
+                *colon = '\0';
+                if (!isdigit((unsigned char)colon[1])) return 0;
+                opt->xdp_queue = atoi(colon + 1);
+            }
+            continue;
+        }
+
+        /* -C ms: responder XDP con refresh delle risposte ogni ms millisecondi */
+        if (strcmp(argv[i], "-C") == 0) {
+            opt->xdp_cache_ms = atoi(argv[++i]);
+            if (opt->xdp_cache_ms <= 0) return 0;
+            continue;
+        }
+
+        /* -S secondi: stampa periodica delle statistiche */
+        if (strcmp(argv[i], "-S") == 0) {
+            opt->stats_interval = atoi(argv[++i]);
+            if (opt->stats_interval <= 0) return 0;
+            continue;
+        }
+
+        /* -O file: oggetto BPF del programma XDP */
+        if (strcmp(argv[i], "-O") == 0) {
+            opt->xdp_obj = argv[++i];
+            continue;
+        }
+
+        if (strcmp(argv[i], "-p") != 0) return 0;
+
+        int p = atoi(argv[i + 1]);
+        if (p <= 0 || p > 65535)
+        {
+            printf("La porta deve essere compresa tra 0 e 65535\n");
+            return 0;
+        }
+        opt->port = p;
+        i++;
+    }
 
-    if (argv[2][0] == '-') return 0;
+    /* l'orologio di replay vale solo per le serie storiche */
+    if (opt->replay_start != NULL && opt->data_file == NULL) return 0;
 
-    int p = atoi(argv[2]);
-    if (p <= 0 || p > 65535)
-    {
-    	printf("La porta deve essere compresa tra 0 e 65535\n");
-    	return 0;
-    }
-    *port = p;
-    return 1;
+    return 1;  /* se -p manca resta la porta di default */
 }
 
 /* DESERIALIZZAZIONE */
@@ -143,25 +289,138 @@ void serialize_response(const weather_response_t *resp, uint8_t buffer[RESP_BUFF
     offset += sizeof(net_bits);
 }
 
-void resolve_client(const struct sockaddr_in *client_addr, char *client_name, size_t name_len, char *client_ip,   size_t ip_len)
+/* Validazione della richiesta e generazione del valore meteo */
+void process_request(const weather_request_t *req, weather_response_t *resp) {
+    resp->status = STATUS_OK;
+    resp->type   = req->type;
+    resp->value  = 0.0f;
+
+    /* VALIDAZIONE TIPO */
+    if (!valid_type(req->type)) {
+        resp->status = STATUS_BAD_REQUEST;
+        resp->type   = '\0';
+        resp->value  = 0.0f;
+    }
+    /* VALIDAZIONE SINTATTICA CITY (tab, caratteri speciali) */
+    else if (!is_valid_city_syntax(req->city)) {
+        resp->status = STATUS_BAD_REQUEST;
+        resp->type   = '\0';
+        resp->value  = 0.0f;
+    }
+    /* VALIDAZIONE LISTA CITY */
+    else if (!is_valid_city(req->city)) {
+        resp->status = STATUS_CITY_UNKNOWN;
+        resp->type   = '\0';
+        resp->value  = 0.0f;
+    }
+    else {
+        /* valore dalle serie storiche, se caricate e disponibili */
+        if (tsstore_lookup(req->city, req->type, &resp->value))
+            return;
+
+        /* altrimenti genera valore meteo */
+        switch (req->type) {
+            case TYPE_TEMP:
+                resp->value = get_temperature();
+                break;
+            case TYPE_HUM:
+                resp->value = get_humidity();
+                break;
+            case TYPE_WIND:
+                resp->value = get_wind();
+                break;
+            case TYPE_PRESS:
+                resp->value = get_pressure();
+                break;
+            default:
+                resp->status = STATUS_BAD_REQUEST;
+                resp->type   = '\0';
+                resp->value  = 0.0f;
+                break;
+        }
+    }
+}
+
+void resolve_client(const struct sockaddr *client_addr, socklen_t client_len, char *client_name, size_t name_len, char *client_ip, size_t ip_len)
 {
-    struct in_addr addr = client_addr->sin_addr;
+    struct sockaddr_in mapped;
+
+    /* client IPv4 su socket dual-stack: si mostra l'indirizzo IPv4 */
+    if (client_addr->sa_family == AF_INET6) {
+        const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6*)client_addr;
+        if (IN6_IS_ADDR_V4MAPPED(&sin6->sin6_addr)) {
+            memset(&mapped, 0, sizeof(mapped));
+            mapped.sin_family = AF_INET;
+            mapped.sin_port = sin6->sin6_port;
+            memcpy(&mapped.sin_addr, &sin6->sin6_addr.s6_addr[12], sizeof(mapped.sin_addr));
+            client_addr = (const struct sockaddr*)&mapped;
+            client_len = sizeof(mapped);
+        }
+    }
 
     /* IP come stringa */
-    strncpy(client_ip, inet_ntoa(addr), ip_len - 1);
-    client_ip[ip_len - 1] = '\0';
-
-    /* Reverse DNS */
-    struct hostent *he = gethostbyaddr((char*)&addr, 4, AF_INET);
-
-    if (he != NULL) {
-        strncpy(client_name, he->h_name, name_len - 1);
-        client_name[name_len - 1] = '\0';
-    } else {
-        /* fallback */
-        strncpy(client_name, client_ip, name_len - 1);
-        client_name[name_len - 1] = '\0';
+    if (getnameinfo(client_addr, client_len, client_ip, ip_len, NULL, 0, NI_NUMERICHOST) != 0)
+        snprintf(client_ip, ip_len, "?");
+
+    /* Reverse DNS (fallback: IP) */
+    if (getnameinfo(client_addr, client_len, client_name, name_len, NULL, 0, NI_NAMEREQD) != 0)
+        snprintf(client_name, name_len, "%s", client_ip);
+}
+
+
+/* Serve un datagramma UDP: 1 servito, 0 socket vuoto */
+int handle_udp(int my_socket) {
+    struct sockaddr_storage client_addr;
+    socklen_t client_len = sizeof(client_addr);
+
+    uint8_t buffer_req[REQ_BUFFER_SIZE];
+    int recvMsgSize = recvfrom(my_socket, (char*)buffer_req, REQ_BUFFER_SIZE, 0,(struct sockaddr*)&client_addr, &client_len);
+    if (recvMsgSize < 0) {
+#if defined WIN32
+        if (WSAGetLastError() == WSAEWOULDBLOCK) return 0;
+#else
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+#endif
+        errorhandler("recvfrom() failed\n");
+        return 0;
+    }
+
+    if (recvMsgSize != REQ_BUFFER_SIZE) {
+        fprintf(stderr, "Richiesta di dimensione non valida (%d byte)\n", recvMsgSize);
+        return 1;
     }
+
+    weather_request_t req;
+    memset(&req, 0, sizeof(req));
+    deserialize_request(buffer_req, &req);
+
+    if (!quiet_log) {
+        /* DNS reverse*/
+        char cname[NI_MAXHOST], cip[64];
+        resolve_client((struct sockaddr*)&client_addr, client_len, cname, sizeof(cname), cip, sizeof(cip));
+
+        printf("Richiesta ricevuta da %s (ip %s): type='%c', city='%s'\n",cname, cip, req.type, req.city);
+    }
+
+    /* Prepara risposta */
+    weather_response_t resp;
+    process_request(&req, &resp);
+
+    /* SERIALIZZA E INVIA RISPOSTA */
+    uint8_t buffer_resp[RESP_BUFFER_SIZE];
+    serialize_response(&resp, buffer_resp);
+
+    /*
+     * Un invio fallito (buffer pieno, sorgente non raggiungibile) riguarda solo
+     * questo client: non deve fermare il loop né gli altri socket.
+     */
+    if (sendto(my_socket, (const char*)buffer_resp, RESP_BUFFER_SIZE, 0,(struct sockaddr*)&client_addr, client_len) != RESP_BUFFER_SIZE) {
+        errorhandler("sendto() failed (byte inviati diversi dal previsto)\n");
+        return 1;
+    }
+    stats_add(STAT_UDP, 1);
+
+    return 1;
 }
 
 
@@ -180,132 +439,108 @@ int main(int argc, char *argv[]) {
 
     srand((unsigned)time(NULL));
 
-    int port = SERVER_PORT;
+    server_options_t opt;
+    memset(&opt, 0, sizeof(opt));
+    opt.port = SERVER_PORT;
+    opt.busy_cpu = -1;
+    opt.xdp_obj = XDP_OBJ_DEFAULT;
 
-    if (!parse_port(argc, argv, &port)) {
-        printf("Uso corretto: %s [-p porta]\n", argv[0]);
+    if (!parse_args(argc, argv, &opt)) {
+        printf("Uso corretto: %s [-p porta] [-m] [-l indirizzo[:porta][@interfaccia]]... [-B cpu] [-d file [-R epoch]] [-X interfaccia[:coda] [-G] [-O file.bpf.o] [-C ms]] [-S secondi]\n", argv[0]);
         clearwinsock();
         return EXIT_FAILURE;
     }
 
-    /* CREAZIONE SOCKET UDP */
-    int my_socket = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    if (my_socket < 0) {
-        errorhandler("socket() failed\n");
+    int port = opt.port;
+
+    install_signal_handlers();
+    block_stop_signals();
+
+    /* SORGENTE DATI: serie storiche se richieste, generatori casuali come ripiego */
+    if (opt.data_file != NULL && !tsstore_open(opt.data_file)) {
         clearwinsock();
-        return -1;
+        return EXIT_FAILURE;
+    }
+    if (opt.replay_start != NULL)
+        tsstore_set_replay((int64_t)strtoll(opt.replay_start, NULL, 10));
+
+    /* senza -l: tutte le interfacce, IPv6 e IPv4, sulla porta di default */
+    if (opt.n_specs == 0)
+        opt.specs[opt.n_specs++] = "*";
+
+    quiet_log = opt.busy_cpu >= 0;
+    fastpath_set_quiet(quiet_log);
+
+    /* CREAZIONE SOCKET UDP IN ASCOLTO */
+    for (int i = 0; i < opt.n_specs; i++) {
+        char desc[96];
+        int my_socket = listener_open_udp(opt.specs[i], port, desc, sizeof(desc));
+        if (my_socket < 0 || !listener_add(my_socket, handle_udp, desc)) {
+            errorhandler("Impossibile aprire i socket in ascolto\n");
+            if (my_socket >= 0) closesocket(my_socket);
+            event_loop_close();
+            clearwinsock();
+            return EXIT_FAILURE;
+        }
     }
 
-    /* INDIRIZZO SERVER */
-    struct sockaddr_in echoServAddr;
-    memset(&echoServAddr, 0, sizeof(echoServAddr));
-     echoServAddr.sin_family = AF_INET;
-     echoServAddr.sin_port = htons(port);
-     echoServAddr.sin_addr.s_addr = INADDR_ANY;
-
-     /* BIND */
-     if (bind(my_socket, (struct sockaddr*)&echoServAddr, sizeof(echoServAddr)) < 0) {
-             errorhandler("bind() failed\n");
-             closesocket(my_socket);
-             clearwinsock();
-             return EXIT_FAILURE;
-         }
-
-         printf("Server meteo UDP in ascolto sulla porta %d...\n", port);
-	
-         /* LOOP PRINCIPALE  */
-            while (1) {
-                struct sockaddr_in client_addr;
-        #if defined WIN32
-                int client_len = sizeof(client_addr);
-        #else
-                socklen_t client_len = sizeof(client_addr);
-        #endif
-
-                uint8_t buffer_req[REQ_BUFFER_SIZE];
-                int recvMsgSize = recvfrom(my_socket, (char*)buffer_req, REQ_BUFFER_SIZE, 0,(struct sockaddr*)&client_addr, &client_len);
-                if (recvMsgSize < 0) {
-                    errorhandler("recvfrom() failed\n");
-                    continue;
-                }
-
-                if (recvMsgSize != REQ_BUFFER_SIZE) {
-                    fprintf(stderr, "Richiesta di dimensione non valida (%d byte)\n", recvMsgSize);
-                    continue;
-                }
-
-                weather_request_t req;
-                memset(&req, 0, sizeof(req));
-                deserialize_request(buffer_req, &req);
-
-                /* DNS reverse*/
-                char cname[256], cip[64];
-                resolve_client(&client_addr, cname, sizeof(cname), cip, sizeof(cip));
-
-                printf("Richiesta ricevuta da %s (ip %s): type='%c', city='%s'\n",cname, cip, req.type, req.city);
-
-                /* Prepara risposta */
-                weather_response_t resp;
-                resp.status = STATUS_OK;
-                resp.type   = req.type;
-                resp.value  = 0.0f;
-
-                /* VALIDAZIONE TIPO */
-                if (!valid_type(req.type)) {
-                    resp.status = STATUS_BAD_REQUEST;
-                    resp.type   = '\0';
-                    resp.value  = 0.0f;
-                }
-                /* VALIDAZIONE SINTATTICA CITY (tab, caratteri speciali) */
-                else if (!is_valid_city_syntax(req.city)) {
-                            resp.status = STATUS_BAD_REQUEST;
-                            resp.type   = '\0';
-                            resp.value  = 0.0f;
-                }
-                /* VALIDAZIONE LISTA CITY */
-                else if (!is_valid_city(req.city)) {
-                    resp.status = STATUS_CITY_UNKNOWN;
-                    resp.type   = '\0';
-                    resp.value  = 0.0f;
-                }
-                else {
-                    /* genera valore meteo */
-                    switch (req.type) {
-                        case TYPE_TEMP:
-                            resp.value = get_temperature();
-                            break;
-                        case TYPE_HUM:
-                            resp.value = get_humidity();
-                            break;
-                        case TYPE_WIND:
-                            resp.value = get_wind();
-                            break;
-                        case TYPE_PRESS:
-                            resp.value = get_pressure();
-                            break;
-                        default:
-                            resp.status = STATUS_BAD_REQUEST;
-                            resp.type   = '\0';
-                            resp.value  = 0.0f;
-                            break;
-                    }
-                }
-
-                /* SERIALIZZA E INVIA RISPOSTA */
-                uint8_t buffer_resp[RESP_BUFFER_SIZE];
-                serialize_response(&resp, buffer_resp);
-
-                if (sendto(my_socket, (const char*)buffer_resp, RESP_BUFFER_SIZE, 0,(struct sockaddr*)&client_addr, client_len) != RESP_BUFFER_SIZE) {
-                    errorhandler("sendto() failed (byte inviati diversi dal previsto)\n");
-                    return -1;
-                }
-            }
+    printf("Server meteo UDP in ascolto sulla porta %d...\n", port);
+
+    /* ENDPOINT LOCALI (AF_UNIX e, se richiesto, memoria condivisa) */
+    int unix_socket = fastpath_unix_open(port);
+    if (unix_socket >= 0)
+        listener_add(unix_socket, fastpath_unix_handle, "unix");
+    if (opt.use_shm)
+        fastpath_shm_start(port);
+
+    /* PERCORSO AF_XDP: il programma XDP ridirige le richieste al socket della coda */
+    if (opt.xdp_ifname[0] != '\0') {
+        int xdp_ok = 0;
+        if (xdp_prog_load(opt.xdp_obj, opt.xdp_ifname, port, opt.xdp_generic)) {
+            int xsk = afxdp_open(opt.xdp_queue);
+            xdp_ok = xsk >= 0 && listener_add(xsk, afxdp_handle, "af_xdp");
+        }
+
+        /* RESPONDER XDP: le coppie (città, tipo) note rispondono dal driver */
+        if (xdp_ok && opt.xdp_cache_ms > 0)
+            xdp_ok = xdp_cache_start(opt.xdp_cache_ms);
+
+        if (!xdp_ok) {
+            errorhandler("Impossibile attivare il percorso XDP\n");
+            xdp_cache_stop();
+            afxdp_close();
+            xdp_prog_unload();
+            fastpath_shm_stop();
+            event_loop_close();
+            fastpath_unix_close(port, -1);
+            clearwinsock();
+            return EXIT_FAILURE;
+        }
+    }
 
+    if (opt.xdp_cache_ms > 0 && opt.xdp_ifname[0] == '\0')
+        errorhandler("-C richiede -X: responder XDP non attivato\n");
+
+    if (opt.stats_interval > 0)
+        stats_start(opt.stats_interval);
+
+    /* LOOP PRINCIPALE  */
+    int loop_result = event_loop_run(opt.busy_cpu);
 
 	printf("Server terminated.\n");
 
+	/* il thread delle statistiche legge stats_map: va fermato prima di chiuderla */
+	stats_stop();
+	stats_print();
+
 	//CHIUSURA SOCKET
-	closesocket(my_socket);
+	xdp_cache_stop();
+	afxdp_close();
+	xdp_prog_unload();
+	fastpath_shm_stop();
+	event_loop_close();
+	fastpath_unix_close(port, -1);
+	tsstore_close();
 	clearwinsock();
-	return 0;
+	return loop_result < 0 ? EXIT_FAILURE : 0;
 } // main end
@@ -0,0 +1,118 @@
+/*
+ * stats.c
+ *
+ * Contatori globali del server.
+ */
+
+#include <stdio.h>
+#include "stats.h"
+#include "xdp_cache.h"
+
+static unsigned long long counters[STAT_COUNT];
+static int stats_interval = 0;
+
+void stats_add(int counter, unsigned long long n) {
+    __atomic_add_fetch(&counters[counter], n, __ATOMIC_RELAXED);
+}
+
+/* Somma di tutti i contatori, per capire se è cambiato qualcosa */
+static unsigned long long stats_total(void) {
+    unsigned long long total = 0, hits = 0, misses = 0, refreshes = 0;
+    int interval_ms;
+
+    for (int i = 0; i < STAT_COUNT; i++)
+        total += __atomic_load_n(&counters[i], __ATOMIC_RELAXED);
+    if (xdp_cache_counters(&hits, &misses, &refreshes, &interval_ms))
+        total += hits + misses;
+    return total;
+}
+
+void stats_print(void) {
+    unsigned long long hits, misses, refreshes;
+    int interval_ms;
+
+    printf("Statistiche: udp=%llu unix=%llu shm=%llu af_xdp=%llu",
+           __atomic_load_n(&counters[STAT_UDP], __ATOMIC_RELAXED),
+           __atomic_load_n(&counters[STAT_UNIX], __ATOMIC_RELAXED),
+           __atomic_load_n(&counters[STAT_SHM], __ATOMIC_RELAXED),
+           __atomic_load_n(&counters[STAT_AFXDP], __ATOMIC_RELAXED));
+
+    if (xdp_cache_counters(&hits, &misses, &refreshes, &interval_ms))
+        printf(" | xdp hit=%llu miss=%llu, refresh ogni %d ms (%llu eseguiti)",
+               hits, misses, interval_ms, refreshes);
+
+    printf("\n");
+    fflush(stdout);
+}
+
+#if defined WIN32
+
+int stats_start(int interval_s) {
+    (void)interval_s;
+    fprintf(stderr, "Statistiche periodiche non disponibili su Windows\n");
+    return 0;
+}
+
+void stats_stop(void) { }
+
+#else
+
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+/* arresto del thread senza aspettare l'intervallo intero (come in xdp_cache.c) */
+static pthread_t stats_tid;
+static pthread_mutex_t stop_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stop_cond = PTHREAD_COND_INITIALIZER;
+static int stop_requested = 0;
+static int thread_running = 0;
+
+static void *stats_thread(void *arg) {
+    unsigned long long last = 0;
+    (void)arg;
+
+    pthread_mutex_lock(&stop_lock);
+    while (!stop_requested) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += stats_interval;
+
+        if (pthread_cond_timedwait(&stop_cond, &stop_lock, &deadline) == ETIMEDOUT && !stop_requested) {
+            pthread_mutex_unlock(&stop_lock);
+            unsigned long long total = stats_total();
+            if (total != last) {
+                stats_print();
+                last = total;
+            }
+            pthread_mutex_lock(&stop_lock);
+        }
+    }
+    pthread_mutex_unlock(&stop_lock);
+
+    return NULL;
+}
+
+int stats_start(int interval_s) {
+    stats_interval = interval_s;
+    stop_requested = 0;
+    if (pthread_create(&stats_tid, NULL, stats_thread, NULL) != 0) {
+        fprintf(stderr, "pthread_create() failed\n");
+        return 0;
+    }
+    thread_running = 1;
+    return 1;
+}
+
+void stats_stop(void) {
+    if (!thread_running) return;
+
+    pthread_mutex_lock(&stop_lock);
+    stop_requested = 1;
+    pthread_cond_signal(&stop_cond);
+    pthread_mutex_unlock(&stop_lock);
+    pthread_join(stats_tid, NULL);
+    thread_running = 0;
+}
+
+#endif /* WIN32 */
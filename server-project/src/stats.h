@@ -0,0 +1,29 @@
+/*
+ * stats.h
+ *
+ * Contatori delle richieste servite per percorso e stampa periodica,
+ * insieme ai contatori del responder XDP quando è attivo.
+ */
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#define STAT_UDP    0
+#define STAT_UNIX   1
+#define STAT_SHM    2
+#define STAT_AFXDP  3
+#define STAT_COUNT  4
+
+/* Conta n richieste servite sul percorso counter (thread-safe) */
+void stats_add(int counter, unsigned long long n);
+
+/* Stampa una riga con tutti i contatori */
+void stats_print(void);
+
+/* Avvia la stampa ogni interval_s secondi (solo se qualcosa è cambiato) */
+int stats_start(int interval_s);
+
+/* Ferma la stampa periodica: da chiamare prima di chiudere le mappe XDP */
+void stats_stop(void);
+
+#endif /* STATS_H_ */
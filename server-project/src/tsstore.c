@@ -0,0 +1,189 @@
+/*
+ * tsstore.c
+ *
+ * Lettura del file colonnare di serie storiche (vedi tsstore.h).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "tsstore.h"
+
+int ts_metric_index(char type) {
+    switch (type) {
+        case TYPE_TEMP:  return 0;
+        case TYPE_HUM:   return 1;
+        case TYPE_WIND:  return 2;
+        case TYPE_PRESS: return 3;
+        default:         return -1;
+    }
+}
+
+#if defined WIN32
+
+int tsstore_open(const char *path) {
+    (void)path;
+    fprintf(stderr, "File di serie storiche non supportato su Windows\n");
+    return 0;
+}
+void tsstore_set_replay(int64_t start) { (void)start; }
+int tsstore_lookup(const char *city, char type, float *value) { (void)city; (void)type; (void)value; return 0; }
+void tsstore_close(void) { }
+
+#else
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const uint8_t *base = NULL;
+static size_t base_len = 0;
+static const ts_header_t *hdr = NULL;
+static const ts_city_t *cities = NULL;
+static const int64_t *ts_index = NULL;
+static const float *values = NULL;
+
+/* differenza tra orologio di replay e orologio reale (0 = tempo reale) */
+static int64_t replay_offset = 0;
+
+/*
+ * Verifica che count elementi di elem_size byte a partire da offset stiano
+ * nel file. Si divide invece di moltiplicare: count viene dall'header e il
+ * prodotto potrebbe traboccare.
+ */
+static int in_file(uint64_t offset, uint64_t count, uint64_t elem_size) {
+    return offset <= base_len && count <= (base_len - offset) / elem_size;
+}
+
+/* Ogni serie dichiarata dalle città deve stare nell'indice */
+static int series_valid(void) {
+    for (uint32_t c = 0; c < hdr->n_cities; c++)
+        for (int m = 0; m < TS_METRICS; m++)
+            if ((uint64_t)cities[c].first[m] + cities[c].count[m] > hdr->n_samples)
+                return 0;
+    return 1;
+}
+
+int tsstore_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("open() failed (file serie storiche)");
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(ts_header_t)) {
+        fprintf(stderr, "File di serie storiche non valido: %s\n", path);
+        close(fd);
+        return 0;
+    }
+
+    void *mem = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        perror("mmap() failed (file serie storiche)");
+        return 0;
+    }
+
+    base = (const uint8_t*)mem;
+    base_len = (size_t)st.st_size;
+    hdr = (const ts_header_t*)base;
+
+    uint64_t nc = hdr->n_cities, ns = hdr->n_samples;
+    if (hdr->magic != TS_MAGIC || hdr->version != TS_VERSION || nc == 0 || ns == 0 ||
+        hdr->cities_offset % sizeof(uint32_t) != 0 ||
+        hdr->index_offset % sizeof(int64_t) != 0 || hdr->values_offset % sizeof(float) != 0 ||
+        !in_file(hdr->cities_offset, nc, sizeof(ts_city_t)) ||
+        !in_file(hdr->index_offset, ns, sizeof(int64_t)) ||
+        !in_file(hdr->values_offset, ns, sizeof(float))) {
+        fprintf(stderr, "File di serie storiche non valido: %s\n", path);
+        tsstore_close();
+        return 0;
+    }
+
+    cities = (const ts_city_t*)(base + hdr->cities_offset);
+    ts_index = (const int64_t*)(base + hdr->index_offset);
+    values = (const float*)(base + hdr->values_offset);
+
+    if (!series_valid()) {
+        fprintf(stderr, "File di serie storiche non valido: %s\n", path);
+        tsstore_close();
+        return 0;
+    }
+
+    /*
+     * ogni richiesta tocca poche pagine sparse (indice e una serie):
+     * niente read-ahead
+     */
+    madvise(mem, base_len, MADV_RANDOM);
+
+    printf("Serie storiche: %u citta', %u campioni da %s\n", hdr->n_cities, hdr->n_samples, path);
+    return 1;
+}
+
+void tsstore_set_replay(int64_t start) {
+    replay_offset = start - (int64_t)time(NULL);
+}
+
+/* Ricerca binaria della città nella tabella ordinata */
+static int find_city(const char *city) {
+    char lower[CITY_MAX];
+    size_t i;
+
+    for (i = 0; i < CITY_MAX - 1 && city[i]; i++)
+        lower[i] = (char)tolower((unsigned char)city[i]);
+    lower[i] = '\0';
+
+    int lo = 0, hi = (int)hdr->n_cities - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        int c = strncmp(lower, cities[mid].name, CITY_MAX);
+        if (c == 0) return mid;
+        if (c < 0) hi = mid - 1;
+        else lo = mid + 1;
+    }
+    return -1;
+}
+
+/* Posizione del campione più vicino a t nella serie [first, first + count), count > 0 */
+static uint32_t nearest_sample(uint32_t first, uint32_t count, int64_t t) {
+    uint32_t lo = first, hi = first + count;
+
+    /* primo campione con istante >= t */
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (ts_index[mid] < t) lo = mid + 1;
+        else hi = mid;
+    }
+
+    if (lo == first + count) return lo - 1;
+    if (lo > first && t - ts_index[lo - 1] <= ts_index[lo] - t) return lo - 1;
+    return lo;
+}
+
+int tsstore_lookup(const char *city, char type, float *value) {
+    if (hdr == NULL) return 0;
+
+    int m = ts_metric_index(type);
+    int c = find_city(city);
+    if (m < 0 || c < 0 || cities[c].count[m] == 0) return 0;
+
+    uint32_t s = nearest_sample(cities[c].first[m], cities[c].count[m], (int64_t)time(NULL) + replay_offset);
+    *value = values[s];
+    return 1;
+}
+
+void tsstore_close(void) {
+    if (base != NULL)
+        munmap((void*)base, base_len);
+    base = NULL;
+    base_len = 0;
+    hdr = NULL;
+    cities = NULL;
+    ts_index = NULL;
+    values = NULL;
+}
+
+#endif /* WIN32 */
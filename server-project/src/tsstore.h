@@ -0,0 +1,66 @@
+/*
+ * tsstore.h
+ *
+ * Sorgente dati alternativa ai generatori casuali: file colonnare di serie
+ * storiche per città, mappato in memoria.
+ *
+ * Formato (byte order nativo, tutti gli offset dall'inizio del file):
+ *
+ *   ts_header_t
+ *   ts_city_t    cities[n_cities]       nomi in minuscolo, ordinati
+ *   int64_t      index[n_samples]       istanti (epoch s)
+ *   float        values[n_samples]      valore della stessa posizione di index
+ *
+ * Ogni serie (città, metrica) occupa le posizioni [first, first + count) di
+ * index e values, con istanti strettamente crescenti. Le serie contengono
+ * solo le osservazioni presenti: i dati mancanti non occupano spazio e il
+ * campione più vicino di una serie ha sempre un valore. I file si generano
+ * con tools/tsbuild.c.
+ */
+
+#ifndef TSSTORE_H_
+#define TSSTORE_H_
+
+#include <stdint.h>
+#include "protocol.h"
+
+#define TS_MAGIC   0x53545757u    // "WWTS"
+#define TS_VERSION 2
+#define TS_METRICS 4              // ordine delle serie: TYPE_TEMP, TYPE_HUM, TYPE_WIND, TYPE_PRESS
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t n_cities;
+    uint32_t n_samples;                 // osservazioni di tutte le serie
+    uint64_t cities_offset;
+    uint64_t index_offset;
+    uint64_t values_offset;
+} ts_header_t;
+
+typedef struct {
+    char name[CITY_MAX];
+    uint32_t first[TS_METRICS];         // inizio della serie per metrica
+    uint32_t count[TS_METRICS];         // campioni della serie (0 = nessun dato)
+} ts_city_t;
+
+/* Colonna della metrica per il tipo di richiesta; -1 se il tipo non è valido */
+int ts_metric_index(char type);
+
+/* Mappa il file in memoria e ne verifica la struttura; 0 su errore */
+int tsstore_open(const char *path);
+
+/* Orologio di replay: l'istante start corrisponde all'avvio del server */
+void tsstore_set_replay(int64_t start);
+
+/*
+ * Valore della serie (città, tipo) nel campione più vicino all'istante
+ * corrente (o all'orologio di replay). Nessuna allocazione: una ricerca
+ * binaria sulle città e una sull'indice della serie, entrambe sui dati
+ * mappati. 0 se il file non è caricato o la serie è vuota.
+ */
+int tsstore_lookup(const char *city, char type, float *value);
+
+void tsstore_close(void);
+
+#endif /* TSSTORE_H_ */
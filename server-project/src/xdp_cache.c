@@ -0,0 +1,188 @@
+/*
+ * xdp_cache.c
+ *
+ * Riempimento periodico di resp_cache e lettura dei contatori di stats_map.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "xdp_cache.h"
+
+#if defined HAVE_XDP
+
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <bpf/libbpf.h>
+#include <bpf/bpf.h>
+#include "protocol.h"
+#include "xdp_weather.h"
+#include "xdp_prog.h"
+
+static const char types[] = { TYPE_TEMP, TYPE_HUM, TYPE_WIND, TYPE_PRESS };
+
+static int cache_fd = -1;
+static int stats_fd = -1;
+static int refresh_ms = 0;
+static unsigned long long refreshes = 0;
+
+/* arresto del thread di refresh senza aspettare l'intervallo intero */
+static pthread_t refresh_tid;
+static pthread_mutex_t stop_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stop_cond = PTHREAD_COND_INITIALIZER;
+static int stop_requested = 0;
+static int thread_running = 0;
+
+/* Una risposta nuova per ogni coppia (città, tipo) valida */
+static int refresh(void) {
+    for (int c = 0; c < CITY_COUNT; c++) {
+        for (int t = 0; t < (int)sizeof(types); t++) {
+            weather_request_t req;
+            memset(&req, 0, sizeof(req));
+            req.type = types[t];
+            snprintf(req.city, sizeof(req.city), "%s", city_list[c]);
+
+            weather_response_t resp;
+            process_request(&req, &resp);
+
+            struct xdp_cache_key key;
+            struct xdp_cache_value val;
+            memset(&key, 0, sizeof(key));
+            key.type = (__u8)req.type;
+            memcpy(key.city, req.city, sizeof(key.city));
+            serialize_response(&resp, val.resp);
+
+            if (bpf_map_update_elem(cache_fd, &key, &val, BPF_ANY) != 0) {
+                fprintf(stderr, "Aggiornamento di resp_cache fallito: %s\n", strerror(errno));
+                return 0;
+            }
+        }
+    }
+
+    __atomic_add_fetch(&refreshes, 1, __ATOMIC_RELAXED);
+    return 1;
+}
+
+static void *refresh_thread(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&stop_lock);
+    while (!stop_requested) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += refresh_ms / 1000;
+        deadline.tv_nsec += (refresh_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        if (pthread_cond_timedwait(&stop_cond, &stop_lock, &deadline) == ETIMEDOUT && !stop_requested) {
+            pthread_mutex_unlock(&stop_lock);
+            refresh();
+            pthread_mutex_lock(&stop_lock);
+        }
+    }
+    pthread_mutex_unlock(&stop_lock);
+
+    return NULL;
+}
+
+int xdp_cache_start(int interval_ms) {
+    cache_fd = xdp_prog_map_fd("resp_cache");
+    stats_fd = xdp_prog_map_fd("stats_map");
+    if (cache_fd < 0 || stats_fd < 0) {
+        fprintf(stderr, "Il responder XDP richiede il programma XDP agganciato\n");
+        return 0;
+    }
+
+    refresh_ms = interval_ms;
+    if (!refresh())
+        return 0;
+
+    stop_requested = 0;
+    if (pthread_create(&refresh_tid, NULL, refresh_thread, NULL) != 0) {
+        fprintf(stderr, "pthread_create() failed\n");
+        return 0;
+    }
+    thread_running = 1;
+
+    printf("Responder XDP attivo: %d risposte, refresh ogni %d ms\n",
+           CITY_COUNT * (int)sizeof(types), refresh_ms);
+    return 1;
+}
+
+void xdp_cache_stop(void) {
+    if (cache_fd < 0) return;
+
+    if (thread_running) {
+        pthread_mutex_lock(&stop_lock);
+        stop_requested = 1;
+        pthread_cond_signal(&stop_cond);
+        pthread_mutex_unlock(&stop_lock);
+        pthread_join(refresh_tid, NULL);
+        thread_running = 0;
+    }
+
+    /*
+     * Svuota la mappa: se il programma restasse agganciato (sgancio fallito,
+     * oggetto BPF condiviso) non risponderebbe più con valori non aggiornati.
+     */
+    for (int c = 0; c < CITY_COUNT; c++) {
+        for (int t = 0; t < (int)sizeof(types); t++) {
+            struct xdp_cache_key key;
+            memset(&key, 0, sizeof(key));
+            key.type = (__u8)types[t];
+            snprintf(key.city, sizeof(key.city), "%s", city_list[c]);
+            bpf_map_delete_elem(cache_fd, &key);
+        }
+    }
+
+    cache_fd = -1;
+    stats_fd = -1;
+    refresh_ms = 0;
+}
+
+/* Somma per-CPU di un indice di stats_map */
+static unsigned long long read_counter(__u32 idx) {
+    int ncpu = libbpf_num_possible_cpus();
+    if (ncpu <= 0) return 0;
+
+    __u64 values[ncpu];
+    if (bpf_map_lookup_elem(stats_fd, &idx, values) != 0)
+        return 0;
+
+    unsigned long long sum = 0;
+    for (int i = 0; i < ncpu; i++)
+        sum += values[i];
+    return sum;
+}
+
+int xdp_cache_counters(unsigned long long *hits, unsigned long long *misses,
+                       unsigned long long *refresh_count, int *interval_ms) {
+    if (stats_fd < 0 || refresh_ms == 0) return 0;
+
+    *hits = read_counter(XDP_STAT_HIT);
+    *misses = read_counter(XDP_STAT_MISS);
+    *refresh_count = __atomic_load_n(&refreshes, __ATOMIC_RELAXED);
+    *interval_ms = refresh_ms;
+    return 1;
+}
+
+#else
+
+int xdp_cache_start(int interval_ms) {
+    (void)interval_ms;
+    fprintf(stderr, "Responder XDP non compilato (serve -DHAVE_XDP e libbpf)\n");
+    return 0;
+}
+
+void xdp_cache_stop(void) { }
+
+int xdp_cache_counters(unsigned long long *hits, unsigned long long *misses,
+                       unsigned long long *refreshes, int *interval_ms) {
+    (void)hits; (void)misses; (void)refreshes; (void)interval_ms;
+    return 0;
+}
+
+#endif /* HAVE_XDP */
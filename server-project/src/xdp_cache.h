@@ -0,0 +1,25 @@
+/*
+ * xdp_cache.h
+ *
+ * Responder XDP nel kernel: il server riempie resp_cache con le risposte
+ * già serializzate per ogni coppia (città, tipo) valida e le rinnova a
+ * intervalli regolari. Richiede il programma XDP caricato (xdp_prog.h).
+ */
+
+#ifndef XDP_CACHE_H_
+#define XDP_CACHE_H_
+
+/* Riempie la mappa e avvia il thread di refresh ogni interval_ms */
+int xdp_cache_start(int interval_ms);
+
+/* Ferma il refresh e svuota resp_cache: da chiamare prima dello sgancio */
+void xdp_cache_stop(void);
+
+/*
+ * Contatori del programma XDP (somma su tutte le CPU) e del refresh.
+ * 0 se il responder non è attivo.
+ */
+int xdp_cache_counters(unsigned long long *hits, unsigned long long *misses,
+                       unsigned long long *refreshes, int *interval_ms);
+
+#endif /* XDP_CACHE_H_ */
@@ -0,0 +1,125 @@
+/*
+ * xdp_prog.c
+ *
+ * Caricamento del programma XDP con libbpf.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "xdp_prog.h"
+
+#if defined HAVE_XDP
+
+#include <errno.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <linux/if_link.h>
+#include <bpf/libbpf.h>
+#include <bpf/bpf.h>
+#include "xdp_weather.h"
+
+static struct bpf_object *obj = NULL;
+static int ifindex = 0;
+static __u32 attach_flags = 0;
+
+int xdp_prog_load(const char *obj_path, const char *ifname, int port, int generic) {
+    ifindex = (int)if_nametoindex(ifname);
+    if (ifindex == 0) {
+        fprintf(stderr, "Interfaccia XDP sconosciuta: %s\n", ifname);
+        return 0;
+    }
+
+    obj = bpf_object__open_file(obj_path, NULL);
+    if (obj == NULL) {
+        fprintf(stderr, "Apertura di %s fallita: %s\n", obj_path, strerror(errno));
+        return 0;
+    }
+
+    if (bpf_object__load(obj) != 0) {
+        fprintf(stderr, "Caricamento di %s nel kernel fallito: %s\n", obj_path, strerror(errno));
+        xdp_prog_unload();
+        return 0;
+    }
+
+    struct bpf_program *prog = bpf_object__find_program_by_name(obj, "xdp_weather");
+    if (prog == NULL) {
+        fprintf(stderr, "Programma xdp_weather assente in %s\n", obj_path);
+        xdp_prog_unload();
+        return 0;
+    }
+
+    /* la porta va configurata prima dell'aggancio */
+    __u32 zero = 0;
+    struct xdp_weather_config cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.port = htons((uint16_t)port);
+    if (bpf_map_update_elem(xdp_prog_map_fd("config_map"), &zero, &cfg, BPF_ANY) != 0) {
+        fprintf(stderr, "Configurazione del programma XDP fallita: %s\n", strerror(errno));
+        xdp_prog_unload();
+        return 0;
+    }
+
+    int prog_fd = bpf_program__fd(prog);
+    int err = -1;
+    if (!generic) {
+        attach_flags = XDP_FLAGS_UPDATE_IF_NOEXIST | XDP_FLAGS_DRV_MODE;
+        err = bpf_xdp_attach(ifindex, prog_fd, attach_flags, NULL);
+    }
+
+    /* modalità generica: richiesta o scheda senza XDP nativo */
+    if (err != 0) {
+        attach_flags = XDP_FLAGS_UPDATE_IF_NOEXIST | XDP_FLAGS_SKB_MODE;
+        err = bpf_xdp_attach(ifindex, prog_fd, attach_flags, NULL);
+    }
+
+    if (err != 0) {
+        fprintf(stderr, "Aggancio XDP a %s fallito: %s\n", ifname, strerror(-err));
+        /* XDP_FLAGS_UPDATE_IF_NOEXIST: c'è già un programma (es. server ucciso con SIGKILL) */
+        if (err == -EBUSY || err == -EEXIST)
+            fprintf(stderr, "Rimuovere il programma rimasto con: ip link set dev %s xdp off (xdpgeneric off in modalita' generica)\n", ifname);
+        attach_flags = 0;
+        xdp_prog_unload();
+        return 0;
+    }
+
+    printf("Programma XDP agganciato a %s (modalita' %s)\n", ifname,
+           (attach_flags & XDP_FLAGS_SKB_MODE) ? "generica" : "nativa");
+    return 1;
+}
+
+int xdp_prog_map_fd(const char *name) {
+    if (obj == NULL) return -1;
+    return bpf_object__find_map_fd_by_name(obj, name);
+}
+
+int xdp_prog_ifindex(void) {
+    return ifindex;
+}
+
+int xdp_prog_generic(void) {
+    return (attach_flags & XDP_FLAGS_SKB_MODE) != 0;
+}
+
+void xdp_prog_unload(void) {
+    if (obj == NULL) return;
+
+    if (attach_flags != 0)
+        bpf_xdp_detach(ifindex, attach_flags & ~XDP_FLAGS_UPDATE_IF_NOEXIST, NULL);
+    bpf_object__close(obj);
+    obj = NULL;
+    attach_flags = 0;
+}
+
+#else
+
+int xdp_prog_load(const char *obj_path, const char *ifname, int port, int generic) {
+    (void)obj_path; (void)ifname; (void)port; (void)generic;
+    fprintf(stderr, "Supporto XDP non compilato (serve -DHAVE_XDP e libbpf)\n");
+    return 0;
+}
+int xdp_prog_map_fd(const char *name) { (void)name; return -1; }
+int xdp_prog_ifindex(void) { return 0; }
+int xdp_prog_generic(void) { return 0; }
+void xdp_prog_unload(void) { }
+
+#endif /* HAVE_XDP */
@@ -0,0 +1,31 @@
+/*
+ * xdp_prog.h
+ *
+ * Caricamento del programma XDP del server (bpf/xdp_weather.bpf.c) su
+ * un'interfaccia e accesso alle sue mappe. Richiede libbpf: il supporto
+ * si abilita compilando con -DHAVE_XDP e linkando -lbpf.
+ */
+
+#ifndef XDP_PROG_H_
+#define XDP_PROG_H_
+
+#define XDP_OBJ_DEFAULT "xdp_weather.bpf.o"
+
+/*
+ * Carica obj_path e lo aggancia a ifname; port è la porta del servizio.
+ * generic = 1 forza la modalità generica (SKB), utile su veth e su schede
+ * senza supporto XDP nativo; altrimenti si prova la nativa e poi la generica.
+ */
+int xdp_prog_load(const char *obj_path, const char *ifname, int port, int generic);
+
+/* File descriptor della mappa name del programma caricato; -1 se assente */
+int xdp_prog_map_fd(const char *name);
+
+/* Interfaccia e modalità di aggancio (per il socket AF_XDP) */
+int xdp_prog_ifindex(void);
+int xdp_prog_generic(void);
+
+/* Sgancia il programma dall'interfaccia e libera le risorse */
+void xdp_prog_unload(void);
+
+#endif /* XDP_PROG_H_ */
@@ -0,0 +1,42 @@
+/*
+ * xdp_weather.h
+ *
+ * Definizioni condivise tra il programma XDP (bpf/xdp_weather.bpf.c)
+ * e il server. Usa solo i tipi del kernel perché viene compilato anche
+ * con clang -target bpf.
+ */
+
+#ifndef XDP_WEATHER_H_
+#define XDP_WEATHER_H_
+
+#include <linux/types.h>
+
+#define XDP_REQ_LEN     65        // REQ_BUFFER_SIZE in protocol.h
+#define XDP_RESP_LEN    9         // RESP_BUFFER_SIZE in protocol.h
+#define XDP_MAX_QUEUES  64        // code RX gestibili da xsks_map
+
+#define XDP_CITY_MAX    64        // CITY_MAX in protocol.h
+
+/* Indici di stats_map (per-CPU) */
+#define XDP_STAT_HIT    0
+#define XDP_STAT_MISS   1
+#define XDP_STAT_COUNT  2
+
+/* Chiave di resp_cache: tipo e città in minuscolo, byte dopo il terminatore a zero */
+struct xdp_cache_key {
+    __u8 type;
+    char city[XDP_CITY_MAX];
+};
+
+/* Risposta già serializzata (formato di serialize_response) */
+struct xdp_cache_value {
+    __u8 resp[XDP_RESP_LEN];
+};
+
+/* Unica voce di config_map */
+struct xdp_weather_config {
+    __u16 port;                   // porta del servizio, network byte order
+    __u16 pad;
+};
+
+#endif /* XDP_WEATHER_H_ */
@@ -0,0 +1,279 @@
+/*
+ * tsbuild.c
+ *
+ * Converte un CSV di osservazioni meteo nel file di serie storiche letto dal server
+ * con l'opzione -d (formato descritto in src/tsstore.h).
+ *
+ * Righe CSV: timestamp,city,temperature,humidity,wind,pressure
+ *   - timestamp: epoch in secondi oppure "AAAA-MM-GG HH:MM:SS" (UTC)
+ *   - un campo vuoto è un dato mancante: non entra nella serie di quella
+ *     metrica (il server usa il campione presente più vicino)
+ *   - due righe con la stessa città e lo stesso istante: vale l'ultima
+ *   - la prima riga viene saltata se è un'intestazione
+ *
+ * Compilazione: gcc -O2 -o tsbuild tools/tsbuild.c
+ * Uso:          ./tsbuild osservazioni.csv meteo.wts
+ */
+
+#define _DEFAULT_SOURCE   // timegm
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include "../src/tsstore.h"
+
+#define LINE_MAX_LEN 512
+
+typedef struct {
+    int64_t ts;
+    int city;
+    size_t line;                        // a parità di istante vince la riga successiva
+    float v[TS_METRICS];
+} row_t;
+
+static row_t *rows = NULL;
+static size_t n_rows = 0, cap_rows = 0;
+
+static ts_city_t *cities = NULL;
+static size_t n_cities = 0, cap_cities = 0;
+
+static void *grow(void *p, size_t *cap, size_t need, size_t elem) {
+    if (need <= *cap) return p;
+    *cap = *cap ? *cap * 2 : 64;
+    if (*cap < need) *cap = need;
+    p = realloc(p, *cap * elem);
+    if (p == NULL) {
+        fprintf(stderr, "Memoria esaurita\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static char *trim(char *s) {
+    while (isspace((unsigned char)*s)) s++;
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) *--end = '\0';
+    return s;
+}
+
+/* Divide la riga sulle virgole mantenendo i campi vuoti */
+static int split(char *line, char *fields[], int max) {
+    int n = 0;
+    char *p = line;
+    while (n < max) {
+        fields[n++] = p;
+        char *comma = strchr(p, ',');
+        if (comma == NULL) break;
+        *comma = '\0';
+        p = comma + 1;
+    }
+    for (int i = 0; i < n; i++)
+        fields[i] = trim(fields[i]);
+    return n;
+}
+
+static int parse_time(const char *s, int64_t *out) {
+    char *end;
+    long long v = strtoll(s, &end, 10);
+    if (*s != '\0' && *end == '\0') {
+        *out = v;
+        return 1;
+    }
+
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    if (sscanf(s, "%d-%d-%d%*[ T]%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+               &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6)
+        return 0;
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    *out = (int64_t)timegm(&tm);
+    return 1;
+}
+
+static int city_id(const char *name) {
+    ts_city_t c;
+    memset(&c, 0, sizeof(c));
+    for (size_t i = 0; i < CITY_MAX - 1 && name[i]; i++)
+        c.name[i] = (char)tolower((unsigned char)name[i]);
+
+    for (size_t i = 0; i < n_cities; i++)
+        if (strncmp(cities[i].name, c.name, CITY_MAX) == 0)
+            return (int)i;
+
+    cities = grow(cities, &cap_cities, n_cities + 1, sizeof(ts_city_t));
+    cities[n_cities] = c;
+    return (int)n_cities++;
+}
+
+static int cmp_city_idx(const void *a, const void *b) {
+    return strncmp(cities[*(const int*)a].name, cities[*(const int*)b].name, CITY_MAX);
+}
+
+static int *rank = NULL;               // posizione della città nella tabella ordinata
+
+/* Righe per (città nell'ordine del file, istante, riga del CSV) */
+static int cmp_row(const void *a, const void *b) {
+    const row_t *x = (const row_t*)a, *y = (const row_t*)b;
+    if (x->city != y->city) return rank[x->city] - rank[y->city];
+    if (x->ts != y->ts) return (x->ts > y->ts) - (x->ts < y->ts);
+    return (x->line > y->line) - (x->line < y->line);
+}
+
+static void *xmalloc(size_t size) {
+    void *p = malloc(size ? size : 1);
+    if (p == NULL) {
+        fprintf(stderr, "Memoria esaurita\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        printf("Uso corretto: %s input.csv output.wts\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    FILE *in = fopen(argv[1], "r");
+    if (in == NULL) {
+        perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    /* LETTURA CSV */
+    char line[LINE_MAX_LEN];
+    size_t line_no = 0;
+    while (fgets(line, sizeof(line), in) != NULL) {
+        line_no++;
+        char *fields[2 + TS_METRICS];
+        char *l = trim(line);
+        if (*l == '\0' || *l == '#') continue;
+
+        int n = split(l, fields, 2 + TS_METRICS);
+        row_t r;
+        if (!parse_time(fields[0], &r.ts)) {
+            if (line_no == 1) continue;   // intestazione
+            fprintf(stderr, "Riga %zu: timestamp non valido '%s'\n", line_no, fields[0]);
+            fclose(in);
+            return EXIT_FAILURE;
+        }
+        if (n < 2 || fields[1][0] == '\0' || strlen(fields[1]) >= CITY_MAX) {
+            fprintf(stderr, "Riga %zu: citta' mancante o troppo lunga\n", line_no);
+            fclose(in);
+            return EXIT_FAILURE;
+        }
+
+        r.city = city_id(fields[1]);
+        r.line = line_no;
+        for (int m = 0; m < TS_METRICS; m++) {
+            char *end;
+            r.v[m] = NAN;
+            if (2 + m < n && fields[2 + m][0] != '\0') {
+                r.v[m] = strtof(fields[2 + m], &end);
+                if (*end != '\0') {
+                    fprintf(stderr, "Riga %zu: valore non valido '%s'\n", line_no, fields[2 + m]);
+                    fclose(in);
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+
+        rows = grow(rows, &cap_rows, n_rows + 1, sizeof(row_t));
+        rows[n_rows++] = r;
+    }
+    fclose(in);
+
+    if (n_rows == 0) {
+        fprintf(stderr, "Nessuna osservazione in %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    /* CITTÀ ordinate (il server le cerca con ricerca binaria) */
+    int *order = xmalloc(n_cities * sizeof(int));
+    rank = xmalloc(n_cities * sizeof(int));
+    for (size_t i = 0; i < n_cities; i++)
+        order[i] = (int)i;
+    qsort(order, n_cities, sizeof(int), cmp_city_idx);
+    for (size_t i = 0; i < n_cities; i++)
+        rank[order[i]] = (int)i;
+
+    /*
+     * SERIE: per ogni città e metrica solo le osservazioni presenti, per
+     * istante crescente. Due righe con lo stesso istante: vale l'ultima.
+     */
+    qsort(rows, n_rows, sizeof(row_t), cmp_row);
+
+    if (n_rows > UINT32_MAX / TS_METRICS) {
+        fprintf(stderr, "Troppe osservazioni in %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    int64_t *index = xmalloc(n_rows * TS_METRICS * sizeof(int64_t));
+    float *values = xmalloc(n_rows * TS_METRICS * sizeof(float));
+    ts_city_t *table = xmalloc(n_cities * sizeof(ts_city_t));
+    size_t n_samples = 0;
+
+    for (size_t begin = 0, end; begin < n_rows; begin = end) {
+        for (end = begin; end < n_rows && rows[end].city == rows[begin].city; end++)
+            ;
+        ts_city_t *t = &table[rank[rows[begin].city]];
+        *t = cities[rows[begin].city];
+
+        for (int m = 0; m < TS_METRICS; m++) {
+            t->first[m] = (uint32_t)n_samples;
+            for (size_t i = begin; i < end; i++) {
+                if (rows[i].v[m] != rows[i].v[m]) continue;   // NaN: dato mancante
+                if (n_samples > t->first[m] && index[n_samples - 1] == rows[i].ts)
+                    n_samples--;
+                index[n_samples] = rows[i].ts;
+                values[n_samples++] = rows[i].v[m];
+            }
+            t->count[m] = (uint32_t)(n_samples - t->first[m]);
+        }
+    }
+
+    /* SCRITTURA: header, città, indice e valori allineati a 8 byte */
+    ts_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = TS_MAGIC;
+    hdr.version = TS_VERSION;
+    hdr.n_cities = (uint32_t)n_cities;
+    hdr.n_samples = (uint32_t)n_samples;
+    hdr.cities_offset = sizeof(hdr);
+    hdr.index_offset = (hdr.cities_offset + n_cities * sizeof(ts_city_t) + 7) & ~(uint64_t)7;
+    hdr.values_offset = hdr.index_offset + n_samples * sizeof(int64_t);
+
+    FILE *out = fopen(argv[2], "wb");
+    if (out == NULL) {
+        perror(argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    static const uint8_t zeros[8];
+    size_t pad = hdr.index_offset - (hdr.cities_offset + n_cities * sizeof(ts_city_t));
+    int ok = fwrite(&hdr, sizeof(hdr), 1, out) == 1;
+    ok = ok && fwrite(table, sizeof(ts_city_t), n_cities, out) == n_cities;
+    ok = ok && fwrite(zeros, 1, pad, out) == pad;
+    ok = ok && fwrite(index, sizeof(int64_t), n_samples, out) == n_samples;
+    ok = ok && fwrite(values, sizeof(float), n_samples, out) == n_samples;
+    if (fclose(out) != 0) ok = 0;
+
+    if (!ok) {
+        fprintf(stderr, "Scrittura di %s fallita\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    printf("%s: %zu citta', %zu campioni, %zu osservazioni\n", argv[2], n_cities, n_samples, n_rows);
+
+    free(values);
+    free(table);
+    free(rank);
+    free(order);
+    free(index);
+    free(cities);
+    free(rows);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+#!/bin/sh
+#
+# xdp_veth_test.sh
+#
+# Prova del percorso XDP (-X) e del responder nel kernel (-C) in modalità
+# generica su una coppia veth, con il client in un namespace di rete.
+# Compila l'oggetto BPF e un server con -DHAVE_XDP, verifica che:
+#   - le richieste in cache ricevano risposta con XDP_TX (hit > 0);
+#   - le altre passino dal socket AF_XDP (af_xdp > 0);
+#   - SIGTERM sganci il programma dall'interfaccia;
+#   - un secondo avvio sulla stessa interfaccia riesca.
+#
+# Richiede root, clang, libbpf (header e -lbpf) e iproute2.
+# Da lanciare dalla radice del repository:
+#   sudo sh server-project/tools/xdp_veth_test.sh
+#
+# Esce con 0 se la prova riesce, 1 se fallisce, 77 se mancano i requisiti.
+
+NS=meteo_xdp_test
+DEV=vxdp0
+PEER=vxdp1
+ADDR=10.201.0.1
+PEER_ADDR=10.201.0.2
+PORT=56790
+WORK=$(mktemp -d /tmp/xdp_veth_test.XXXXXX)
+SERVER_PID=
+
+skip() { echo "SKIP: $*"; rm -rf "$WORK"; exit 77; }
+fail() { echo "FAIL: $*"; [ -f "$WORK/server.log" ] && cat "$WORK/server.log"; exit 1; }
+
+cleanup() {
+    [ -n "$SERVER_PID" ] && kill "$SERVER_PID" 2>/dev/null && wait "$SERVER_PID" 2>/dev/null
+    ip link del "$DEV" 2>/dev/null
+    ip netns del "$NS" 2>/dev/null
+    rm -rf "$WORK"
+}
+
+# ---- REQUISITI ----
+[ "$(id -u)" = 0 ] || skip "servono i privilegi di root"
+command -v clang >/dev/null 2>&1 || skip "clang non trovato"
+command -v ip >/dev/null 2>&1 || skip "iproute2 non trovato"
+command -v stdbuf >/dev/null 2>&1 || skip "stdbuf (coreutils) non trovato"
+[ -f /usr/include/bpf/libbpf.h ] || [ -f /usr/local/include/bpf/libbpf.h ] || skip "header di libbpf non trovati"
+[ -d server-project/bpf ] || skip "lanciare dalla radice del repository"
+
+# ---- COMPILAZIONE ----
+ARCH_INC=/usr/include/$(uname -m)-linux-gnu
+clang -O2 -g -target bpf -I"$ARCH_INC" -c server-project/bpf/xdp_weather.bpf.c -o "$WORK/xdp_weather.bpf.o" \
+    || fail "compilazione del programma BPF"
+gcc -O2 -DHAVE_XDP server-project/src/*.c -o "$WORK/server" -lbpf -lpthread || fail "compilazione del server"
+gcc -O2 client-project/src/*.c -o "$WORK/client" || fail "compilazione del client"
+
+# ---- TOPOLOGIA: veth con un capo nel namespace del client ----
+trap cleanup EXIT INT TERM
+ip netns add "$NS" || fail "creazione del namespace"
+ip link add "$DEV" type veth peer name "$PEER" || fail "creazione della coppia veth"
+ip link set "$PEER" netns "$NS"
+ip addr add "$ADDR/24" dev "$DEV"
+ip link set "$DEV" up
+ip netns exec "$NS" ip addr add "$PEER_ADDR/24" dev "$PEER"
+ip netns exec "$NS" ip link set "$PEER" up
+ip netns exec "$NS" ip link set lo up
+# niente offload VLAN in XDP generico
+command -v ethtool >/dev/null 2>&1 && ethtool -K "$DEV" rxvlan off txvlan off >/dev/null 2>&1
+
+start_server() {
+    stdbuf -oL "$WORK/server" -p "$PORT" -X "$DEV:0" -G -O "$WORK/xdp_weather.bpf.o" -C 1000 > "$WORK/server.log" 2>&1 &
+    SERVER_PID=$!
+    for i in 1 2 3 4 5 6 7 8 9 10; do
+        grep -q "Responder XDP attivo" "$WORK/server.log" && return 0
+        kill -0 "$SERVER_PID" 2>/dev/null || break
+        sleep 0.5
+    done
+    fail "avvio del server con XDP"
+}
+
+stop_server() {
+    kill -TERM "$SERVER_PID"
+    wait "$SERVER_PID"
+    SERVER_PID=
+    grep -q "Server terminated" "$WORK/server.log" || fail "chiusura ordinata su SIGTERM"
+    ip -d link show dev "$DEV" | grep -q "prog/xdp" && fail "programma XDP ancora agganciato dopo SIGTERM"
+}
+
+query() {
+    timeout 10 ip netns exec "$NS" "$WORK/client" -s "$ADDR" -p "$PORT" -u "$@"
+}
+
+# ---- PRIMO AVVIO ----
+start_server
+query -n 1000 -r "t bari" | grep -q "Benchmark" || fail "richieste in cache (XDP_TX)"
+query -r "t atlantide" | grep -q "non disponibile" || fail "richiesta fuori cache (AF_XDP)"
+stop_server
+
+STATS=$(grep "^Statistiche" "$WORK/server.log" | tail -1)
+echo "$STATS"
+echo "$STATS" | grep -q "xdp hit=0 " && fail "nessuna risposta da XDP_TX"
+echo "$STATS" | grep -q "af_xdp=0 " && fail "nessuna richiesta servita da AF_XDP"
+
+# ---- SECONDO AVVIO: l'interfaccia deve essere libera ----
+start_server
+query -r "h roma" | grep -q "Roma" || fail "richiesta dopo il riavvio"
+stop_server
+
+echo "PASS"
+exit 0